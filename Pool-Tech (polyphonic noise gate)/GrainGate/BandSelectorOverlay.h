@@ -1,33 +1,251 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <array>
+#include <functional>
+
+//==============================================================================
+/**
+    Two draggable crosshairs (center frequency / threshold) over the spectrum.
+
+    Rendering is layered and cached:
+        grid       - static image, rebuilt on resize only
+        spectrum   - path rebuilt only when setScopeData() delivers a new frame
+        crosshairs - one pre-rendered sprite, blitted per band
+
+    Nothing calls repaint() directly: changes accumulate in a dirty rectangle
+    that is flushed once per display refresh from a VBlankAttachment. A new
+    spectrum frame dirties the old and new path bounds; the path spans the
+    whole frequency axis, so that is expected to be (nearly) full width and
+    only the vertical extent is saved.
+
+    All three layers share one x axis: log frequency, minHz .. maxHz
+    (frequencyToProportion / proportionToFrequency).
+*/
 class BandSelectorOverlay : public juce::Component
 {
 public:
-    struct Crosshair { float freq, thresh; }; // normalized 0..1
-    Crosshair bands[2]; // or std::vector for N bands
+    struct Crosshair { float freq, thresh; }; // 0..1; freq is the proportion along the log frequency axis
+    std::array<Crosshair, 2> bands {{ { 0.2f, 0.5f }, { 0.7f, 0.5f } }};
 
     int draggingIndex = -1;
 
-    void paint(juce::Graphics& g) override {
+    // Called when the user moves a crosshair (write to band1/band2 parameters here)
+    std::function<void(int bandIndex, Crosshair)> onBandMoved;
+
+    // Called once per frame before the dirty region is flushed (poll the analyzer here)
+    std::function<void()> onFrame;
+
+    static constexpr int scopeSize = 128;
+    static constexpr float radius = 8.0f;
+    static constexpr float minDistance = 0.06f; // Normalized, keeps the crosshairs apart
+
+    static constexpr float minHz = 20.0f, maxHz = 20000.0f;
+
+    static float frequencyToProportion(float hz)
+    {
+        return std::log(juce::jlimit(minHz, maxHz, hz) / minHz) / std::log(maxHz / minHz);
+    }
+
+    static float proportionToFrequency(float proportion)
+    {
+        return minHz * std::pow(maxHz / minHz, juce::jlimit(0.0f, 1.0f, proportion));
+    }
+
+    BandSelectorOverlay()
+    {
+        setOpaque(true);
+    }
+
+    // New analyzer frame (values 0..1, point i at i * nyquistHz / size). Only marks the spectrum layer dirty.
+    void setScopeData(const float* data, int size, float nyquistHz)
+    {
+        numScopePoints = juce::jmin(size, scopeSize);
+        std::copy(data, data + numScopePoints, scopeData.begin());
+        scopeHzPerPoint = nyquistHz / float(juce::jmax(1, size));
+        spectrumDirty = true;
+    }
+
+    // Parameter -> GUI (e.g. host automation); repaints just the two sprite areas
+    void setBand(int index, Crosshair c)
+    {
+        invalidate(crosshairBounds(bands[size_t(index)]));
+        bands[size_t(index)] = c;
+        invalidate(crosshairBounds(c));
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        g.drawImageAt(gridImage, 0, 0);
+
+        g.setColour(juce::Colours::lightblue.withAlpha(0.8f));
+        g.strokePath(spectrumPath, juce::PathStrokeType(1.5f));
+
         for (const auto& band : bands)
         {
             auto pt = spectrumToLocal(band.freq, band.thresh);
-            g.setColour(juce::Colours::orange);
-            g.drawEllipse(pt.x - r, pt.y - r, 2*r, 2*r, 2.0f);
-            g.drawLine(...); // crossbars
+            g.drawImageAt(crosshairSprite, int(pt.x - spriteHalf), int(pt.y - spriteHalf));
         }
     }
 
+    void resized() override
+    {
+        rebuildGrid();
+        rebuildCrosshairSprite();
+        spectrumDirty = true;
+        invalidate(getLocalBounds());
+    }
+
     void mouseDown(const juce::MouseEvent& e) override {
         for (int i=0; i<2; ++i)
-            if (clickedNear(e.position, bands[i])) draggingIndex = i;
+            if (clickedNear(e.position, bands[size_t(i)])) draggingIndex = i;
     }
+    void mouseUp(const juce::MouseEvent&) override { draggingIndex = -1; }
+
     void mouseDrag(const juce::MouseEvent& e) override {
         if (draggingIndex >= 0)
         {
-            bands[draggingIndex] = localToSpectrum(e.position, ...);
+            auto& band  = bands[size_t(draggingIndex)];
+            auto& other = bands[size_t(1 - draggingIndex)];
+            invalidate(crosshairBounds(band));
+
+            band = localToSpectrum(e.position);
             // --- Collision avoidance: check against the other band, push away if too close
-            if (areBandsTooClose(bands[0], bands[1]))
-                bands[draggingIndex] = repelFrom(bands[draggingIndex], bands[1]);
-            repaint();
+            if (areBandsTooClose(band, other))
+                band = repelFrom(band, other);
+
+            invalidate(crosshairBounds(band));
+
+            if (onBandMoved)
+                onBandMoved(draggingIndex, band);
+        }
+    }
+
+private:
+    std::array<float, scopeSize> scopeData {};
+    int numScopePoints = 0;
+    float scopeHzPerPoint = 0.0f;
+    bool spectrumDirty = false;
+    juce::Path spectrumPath;
+
+    juce::Image gridImage, crosshairSprite;
+    float spriteHalf = radius + 4.0f;
+
+    juce::Rectangle<int> dirtyArea;
+    juce::VBlankAttachment vblank { this, [this] { onVBlank(); } };
+
+    void invalidate(juce::Rectangle<int> area) { dirtyArea = dirtyArea.getUnion(area); }
+
+    void onVBlank()
+    {
+        if (onFrame)
+            onFrame();
+
+        if (spectrumDirty)
+        {
+            invalidate(spectrumPath.getBounds().getSmallestIntegerContainer().expanded(2));
+            rebuildSpectrumPath();
+            invalidate(spectrumPath.getBounds().getSmallestIntegerContainer().expanded(2));
+            spectrumDirty = false;
+        }
+
+        if (! dirtyArea.isEmpty())
+        {
+            repaint(dirtyArea);
+            dirtyArea = {};
+        }
+    }
+
+    //==============================================================================
+    float frequencyToX(float hz) const { return frequencyToProportion(hz) * getWidth(); }
+
+    juce::Point<float> spectrumToLocal(float freq, float thresh) const
+    {
+        return { freq * getWidth(), (1.0f - thresh) * getHeight() };
+    }
+
+    Crosshair localToSpectrum(juce::Point<float> p) const
+    {
+        return { juce::jlimit(0.0f, 1.0f, p.x / juce::jmax(1.0f, (float) getWidth())),
+                 juce::jlimit(0.0f, 1.0f, 1.0f - p.y / juce::jmax(1.0f, (float) getHeight())) };
+    }
+
+    juce::Rectangle<int> crosshairBounds(const Crosshair& c) const
+    {
+        auto pt = spectrumToLocal(c.freq, c.thresh);
+        return juce::Rectangle<float>(pt.x - spriteHalf, pt.y - spriteHalf, 2 * spriteHalf, 2 * spriteHalf)
+                   .getSmallestIntegerContainer().expanded(1);
+    }
+
+    bool clickedNear(juce::Point<float> p, const Crosshair& c) const
+    {
+        return p.getDistanceFrom(spectrumToLocal(c.freq, c.thresh)) <= radius + 4.0f;
+    }
+
+    static bool areBandsTooClose(const Crosshair& a, const Crosshair& b)
+    {
+        return juce::Point<float>(a.freq, a.thresh).getDistanceFrom({ b.freq, b.thresh }) < minDistance;
+    }
+
+    static Crosshair repelFrom(const Crosshair& moving, const Crosshair& fixed)
+    {
+        juce::Point<float> d(moving.freq - fixed.freq, moving.thresh - fixed.thresh);
+        const float len = d.getDistanceFromOrigin();
+        if (len < 1.0e-6f)
+            d = { 1.0f, 0.0f };
+        else
+            d /= len;
+
+        return { juce::jlimit(0.0f, 1.0f, fixed.freq   + d.x * minDistance),
+                 juce::jlimit(0.0f, 1.0f, fixed.thresh + d.y * minDistance) };
+    }
+
+    //==============================================================================
+    void rebuildGrid()
+    {
+        const int w = juce::jmax(1, getWidth()), h = juce::jmax(1, getHeight());
+        gridImage = juce::Image(juce::Image::RGB, w, h, true);
+        juce::Graphics g(gridImage);
+
+        g.fillAll(juce::Colours::black);
+        g.setColour(juce::Colours::darkgrey);
+
+        // Decades
+        for (float hz : { 100.0f, 1000.0f, 10000.0f })
+            g.drawVerticalLine(int(frequencyToX(hz)), 0.0f, (float) h);
+
+        for (int i = 1; i < 4; ++i)
+            g.drawHorizontalLine(i * h / 4, 0.0f, (float) w);
+    }
+
+    void rebuildCrosshairSprite()
+    {
+        const int size = int(std::ceil(2 * spriteHalf));
+        crosshairSprite = juce::Image(juce::Image::ARGB, size, size, true);
+        juce::Graphics g(crosshairSprite);
+
+        const float c = spriteHalf;
+        g.setColour(juce::Colours::orange);
+        g.drawEllipse(c - radius, c - radius, 2 * radius, 2 * radius, 2.0f);
+        g.drawLine(0.0f, c, (float) size, c, 1.0f); // crossbars
+        g.drawLine(c, 0.0f, c, (float) size, 1.0f);
+    }
+
+    void rebuildSpectrumPath()
+    {
+        spectrumPath.clear();
+        const float h = (float) getHeight();
+
+        // Linear analyzer bins onto the log axis; bins below minHz are off the axis
+        for (int i = 1; i < numScopePoints; ++i)
+        {
+            const float hz = i * scopeHzPerPoint;
+            if (hz < minHz || hz > maxHz)
+                continue;
+
+            const float x = frequencyToX(hz);
+            const float y = (1.0f - juce::jlimit(0.0f, 1.0f, scopeData[size_t(i)])) * h;
+            if (spectrumPath.isEmpty()) spectrumPath.startNewSubPath(x, y);
+            else                        spectrumPath.lineTo(x, y);
         }
     }
 };
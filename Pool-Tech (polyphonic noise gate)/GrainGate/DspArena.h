@@ -0,0 +1,128 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+//==============================================================================
+/**
+    One cache-line-aligned block holding all of an instance's DSP state.
+
+    prepareToPlay computes the footprint for the current sample rate and block
+    size, calls prepare() (the only allocation, and only when the footprint
+    grows), then carves objects and buffers out of it with create()/allocate().
+    Nothing is freed individually: the next prepare() starts over, which is why
+    only trivially destructible types are allowed in here.
+
+    Every allocation is recorded under a name for the memory report.
+*/
+class DspArena
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    // Bytes taken by count Ts, padded to a whole number of cache lines
+    template <typename T>
+    static constexpr size_t bytesFor(size_t count)
+    {
+        return (sizeof(T) * count + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Not realtime safe. Invalidates everything carved out before.
+    void prepare(size_t totalBytes)
+    {
+        if (totalBytes > capacity)
+        {
+            storage.reset(new char[totalBytes + alignment]);
+            const auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+            base = storage.get() + ((alignment - address % alignment) % alignment);
+            capacity = totalBytes;
+        }
+
+        used = 0;
+        numSections = 0;
+    }
+
+    // Value-initialised array of count Ts
+    template <typename T>
+    T* allocate(size_t count, const char* name)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is never destructed");
+        static_assert(alignof(T) <= alignment, "over-aligned type");
+
+        const auto bytes = bytesFor<T>(count);
+        jassert(used + bytes <= capacity); // Footprint computed in prepareToPlay is too small
+        if (used + bytes > capacity)
+            return nullptr;
+
+        auto* p = reinterpret_cast<T*>(base + used);
+        for (size_t i = 0; i < count; ++i)
+            new (p + i) T();
+
+        used += bytes;
+        record(name, bytes);
+        return p;
+    }
+
+    template <typename T>
+    T& create(const char* name)
+    {
+        auto* p = allocate<T>(1, name);
+        jassert(p != nullptr);
+        return *p;
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const     { return used; }
+
+    //==============================================================================
+    struct Section
+    {
+        const char* name = nullptr;
+        size_t bytes = 0;
+    };
+
+    int getNumSections() const                 { return numSections; }
+    const Section& getSection(int index) const { return sections[size_t(index)]; }
+
+    // One line per section plus the total, e.g. for logging or an about box
+    juce::String getReport() const
+    {
+        juce::String report;
+        for (int i = 0; i < numSections; ++i)
+            report << sections[size_t(i)].name << ": " << juce::String(int(sections[size_t(i)].bytes)) << " bytes\n";
+
+        report << "total: " << juce::String(int(used)) << " of " << juce::String(int(capacity)) << " bytes";
+        return report;
+    }
+
+private:
+    static constexpr int maxSections = 32;
+
+    std::unique_ptr<char[]> storage;
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+
+    std::array<Section, maxSections> sections {};
+    int numSections = 0;
+
+    // Sections with the same name (e.g. both channels' pools) are summed
+    void record(const char* name, size_t bytes)
+    {
+        for (int i = 0; i < numSections; ++i)
+        {
+            if (sections[size_t(i)].name == name || std::strcmp(sections[size_t(i)].name, name) == 0)
+            {
+                sections[size_t(i)].bytes += bytes;
+                return;
+            }
+        }
+
+        if (numSections < maxSections)
+            sections[size_t(numSections++)] = { name, bytes };
+    }
+};
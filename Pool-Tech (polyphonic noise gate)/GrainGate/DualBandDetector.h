@@ -0,0 +1,268 @@
+#pragma once
+#include "SimpleBandpass.h"
+#include "HalfbandDecimator.h"
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cmath>
+
+//==============================================================================
+// One detected event. Offsets are relative to the block passed to process(),
+// trigger maps store them as absolute sample positions instead.
+struct GrainTrigger
+{
+    int offset = 0;
+    int band = 0;           // 0 or 1
+    float strength = 0.0f;  // Envelope level (linear) at the threshold crossing
+};
+
+struct DetectorSettings
+{
+    static constexpr int numBands = 2;
+
+    std::array<float, numBands> bandHz      { 80.0f, 2500.0f };
+    std::array<float, numBands> thresholdDb { -24.0f, -24.0f };
+    float q         = 2.0f;
+    float releaseMs = 30.0f;   // Envelope follower release
+    float holdMs    = 15.0f;   // Minimum time between two triggers of the same band
+    float rearmDb   = 3.0f;    // Hysteresis: envelope must fall this far below threshold to re-arm
+
+    bool operator== (const DetectorSettings& o) const
+    {
+        return bandHz == o.bandHz && thresholdDb == o.thresholdDb && q == o.q
+            && releaseMs == o.releaseMs && holdMs == o.holdMs && rearmDb == o.rearmDb;
+    }
+    bool operator!= (const DetectorSettings& o) const { return ! (*this == o); }
+};
+
+//==============================================================================
+/**
+    Dual-bandpass transient detector: the sidechain (mono sum) runs through two
+    sweepable bandpasses, each followed by a peak envelope and a threshold with
+    hysteresis and hold-off. Either band crossing its threshold emits a trigger.
+
+    Multi-rate front end: a cascade of half-band decimators feeds each band at
+    the lowest rate that still covers it (>= 8x its centre frequency), so an
+    80 Hz band at 192 kHz runs at 6 kHz. The cascade stops at ~5.5 kHz, which
+    keeps the cost roughly constant across host sample rates.
+
+    Every trigger is reported exactly getLatencySamples() after the event, no
+    matter which rate its band ran at; callers delay the audio path to match.
+*/
+template <typename SampleType>
+class DualBandDetector
+{
+public:
+    static constexpr int numBands = DetectorSettings::numBands;
+    static constexpr int maxStages = 5;
+
+    // Bump whenever the same input and settings would yield different triggers
+    // (positions, bands, strengths): it is part of every cached TriggerMap's key.
+    // 2: bands run at decimated rates, with the fixed latency removed from trigger positions
+    static constexpr std::uint32_t revision = 2;
+    static constexpr double minDecimatedRate = 5500.0;
+
+    void prepare(double newSampleRate, int maxBlockSize)
+    {
+        sampleRate = newSampleRate;
+        for (auto& b : bands)
+            b.filter.prepare(sampleRate, maxBlockSize);
+
+        maxLevel = levelsForRate(sampleRate);
+        latencySamples = delayAtLevel(maxLevel);
+
+        applySettings();
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& s : stages)
+            s.reset();
+
+        for (auto& b : bands)
+        {
+            b.filter.reset();
+            b.envelope = 0.0f;
+            b.armed = true;
+            b.holdCounter = 0;
+            b.pendingRead = b.pendingWrite = 0;
+        }
+        sampleClock = 0;
+    }
+
+    // Cheap to call every block, filters are only redesigned when something changed
+    void setSettings(const DetectorSettings& newSettings)
+    {
+        if (newSettings != settings)
+        {
+            settings = newSettings;
+            applySettings();
+        }
+    }
+
+    const DetectorSettings& getSettings() const { return settings; }
+
+    // Fixed for a given sample rate (independent of the band settings)
+    int getLatencySamples() const { return latencySamples; }
+    static int getLatencyForRate(double rate) { return delayAtLevel(levelsForRate(rate)); }
+
+    // Decimation level per band (0 = full rate), for diagnostics
+    int getBandLevel(int band) const { return bands[size_t(band)].level; }
+
+    // Runs the detector over one block. Triggers come out sorted by offset and
+    // are placed getLatencySamples() after the event that caused them.
+    // Returns the number written (never more than maxTriggers).
+    int process(const SampleType* sideL, const SampleType* sideR, int numSamples, GrainTrigger* out, int maxTriggers)
+    {
+        const juce::int64 blockStart = sampleClock;
+
+        for (int i = 0; i < numSamples; ++i, ++sampleClock)
+        {
+            SampleType x = SampleType(0.5) * (sideL[i] + sideR[i]);
+
+            for (int level = 0; ; ++level)
+            {
+                for (int b = 0; b < numBands; ++b)
+                    if (bands[size_t(b)].level == level)
+                        processBand(bands[size_t(b)], x);
+
+                if (level == maxLevel || ! stages[size_t(level)].push(x, x))
+                    break;
+            }
+        }
+
+        // Merge both bands' due triggers in time order
+        const juce::int64 blockEnd = blockStart + numSamples;
+        int count = 0;
+
+        while (count < maxTriggers)
+        {
+            int next = -1;
+            for (int b = 0; b < numBands; ++b)
+            {
+                const auto& band = bands[size_t(b)];
+                if (band.pendingRead != band.pendingWrite)
+                {
+                    const auto& p = band.pending[size_t(band.pendingRead)];
+                    if (p.time < blockEnd && (next < 0 || p.time < bands[size_t(next)].pending[size_t(bands[size_t(next)].pendingRead)].time))
+                        next = b;
+                }
+            }
+
+            if (next < 0)
+                break;
+
+            auto& band = bands[size_t(next)];
+            const auto& p = band.pending[size_t(band.pendingRead)];
+            out[count++] = { int(p.time - blockStart), next, p.strength };
+            band.pendingRead = (band.pendingRead + 1) & (pendingSize - 1);
+        }
+
+        return count;
+    }
+
+private:
+    struct Pending
+    {
+        juce::int64 time;
+        float strength;
+    };
+    static constexpr int pendingSize = 8; // Triggers waiting for their latency-aligned position
+
+    struct Band
+    {
+        SimpleBandpass<SampleType> filter;
+        int level = 0;
+        int alignDelay = 0;       // Full-rate samples added so every band reports at latencySamples
+        float envelope = 0.0f;
+        float threshold = 0.1f;
+        float rearmLevel = 0.07f;
+        float releaseCoef = 0.999f;
+        bool armed = true;
+        int holdCounter = 0;
+        int holdSamples = 1;
+
+        std::array<Pending, pendingSize> pending {};
+        int pendingRead = 0, pendingWrite = 0;
+    };
+
+    std::array<HalfbandDecimator<SampleType>, maxStages> stages;
+    std::array<Band, numBands> bands;
+    DetectorSettings settings;
+    double sampleRate = 44100.0;
+    int maxLevel = 0;
+    int latencySamples = 0;
+    juce::int64 sampleClock = 0; // Full-rate samples consumed since reset()
+
+    // Decimation stages in use at a sample rate
+    static int levelsForRate(double rate)
+    {
+        int levels = 0;
+        while (levels < maxStages && rate / double(2 << levels) >= minDecimatedRate)
+            ++levels;
+        return levels;
+    }
+
+    // Group delay of the decimator cascade down to a level, in full-rate samples
+    static int delayAtLevel(int level)
+    {
+        return HalfbandDecimator<SampleType>::latency * ((1 << level) - 1);
+    }
+
+    void processBand(Band& band, SampleType x)
+    {
+        const float y = float(std::abs(band.filter.processSample(x)));
+        band.envelope = std::max(y, band.envelope * band.releaseCoef);
+
+        if (band.holdCounter > 0)
+            --band.holdCounter;
+
+        if (band.armed)
+        {
+            if (band.envelope >= band.threshold && band.holdCounter == 0)
+            {
+                const int nextWrite = (band.pendingWrite + 1) & (pendingSize - 1);
+                jassert(nextWrite != band.pendingRead); // hold-off keeps this from filling up
+                if (nextWrite != band.pendingRead)
+                {
+                    // The decimated sample that crossed was completed by the current full-rate input
+                    band.pending[size_t(band.pendingWrite)] = { sampleClock + band.alignDelay, band.envelope };
+                    band.pendingWrite = nextWrite;
+                }
+                band.armed = false;
+                band.holdCounter = band.holdSamples;
+            }
+        }
+        else if (band.envelope < band.rearmLevel)
+        {
+            band.armed = true;
+        }
+    }
+
+    void applySettings()
+    {
+        for (int b = 0; b < numBands; ++b)
+        {
+            auto& band = bands[size_t(b)];
+
+            // Lowest rate that still covers the band
+            int level = 0;
+            while (level < maxLevel && sampleRate / double(2 << level) >= 8.0 * settings.bandHz[size_t(b)])
+                ++level;
+
+            const double bandRate = sampleRate / double(1 << level);
+            if (level != band.level)
+                band.filter.reset();
+
+            band.level = level;
+            band.alignDelay = latencySamples - delayAtLevel(level);
+
+            band.filter.setSampleRate(bandRate);
+            band.filter.setParams(juce::jlimit(20.0f, float(bandRate * 0.45), settings.bandHz[size_t(b)]), settings.q);
+            band.threshold   = juce::Decibels::decibelsToGain(settings.thresholdDb[size_t(b)]);
+            band.rearmLevel  = juce::Decibels::decibelsToGain(settings.thresholdDb[size_t(b)] - settings.rearmDb);
+            band.releaseCoef = std::exp(-1.0f / std::max(1.0f, float(settings.releaseMs * 0.001 * bandRate)));
+            band.holdSamples = std::max(1, int(settings.holdMs * 0.001 * bandRate));
+        }
+    }
+};
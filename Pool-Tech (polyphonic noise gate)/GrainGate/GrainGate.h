@@ -1,34 +1,55 @@
 #pragma once
 #include "Windower.h"
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
 #include <random>
 #include <array>
 
 enum class EnvelopeState { Inactive, Active, Dying };
 
+template <typename SampleType>
 struct GrainGate
 {
     static constexpr int grainsInPool = 32;
+    static constexpr int quantum = 32; // processBlock size; vector loops always run this wide
     int nextGrainIndex = 0;
+
+    // Quality governor controls (see setQuality)
+    int maxActiveGrains = grainsInPool;
+    float cullBelowGain = 0.0f; // 0 = never cull
+    bool cheapWindows = false;
+
+    // Triggers landing within this many samples of a live grain's start restart that grain (0 = off)
+    int coalesceWindow = 0;
     std::mt19937 rng { std::random_device{}() };
 
     struct PoolGrain
     {
-        Windower window;
+        Windower<SampleType> window;
         bool useInputB = false;
         EnvelopeState state = EnvelopeState::Inactive;
         int dyingCounter = 0;              // Remaining fade-out samples
         int initialDyingCounter = 0;       // Used for scaling
         static constexpr int dyingFadeMs = 8; // Fast fade, tune to taste
         bool wasActive = false;
+        int age = 0;                       // Samples since (re)trigger
 
-        void trigger(int windowType, int length, bool isB)
+        void trigger(int windowType, int length, bool isB, const WindowerParams& params, bool cheapWindows = false)
         {
-            window.startNewGrain(0, windowType, length);
+            window.setCheapReads(cheapWindows);
+            window.startNewGrain(0, windowType, length, params);
             useInputB = isB;
             state = EnvelopeState::Active;
             dyingCounter = 0;
             wasActive = true;
+            age = 0;
+        }
+
+        // Coalesced trigger: same voice, envelope continues from its current gain
+        void retrigger(int windowType, int length, const WindowerParams& params)
+        {
+            window.restartFromCurrentGain(windowType, length, params);
+            age = 0;
         }
 
         // Call when the pool is full and this voice is about to be recycled
@@ -43,22 +64,82 @@ struct GrainGate
 
         bool isActive() const { return state != EnvelopeState::Inactive; }
 
-        float process(float inA, float inB)
+        // Clears voice state but keeps the prepared Windower (sample rate, morph table)
+        void reset()
+        {
+            window.reset();
+            useInputB = false;
+            state = EnvelopeState::Inactive;
+            dyingCounter = initialDyingCounter = 0;
+            wasActive = false;
+            age = 0;
+        }
+
+        SampleType process(SampleType inA, SampleType inB)
+        {
+            return (useInputB ? inB : inA) * nextGain();
+        }
+
+        // Fills gains[0, n) one sample at a time (envelope and cull logic are stateful),
+        // leaving the multiply-accumulate to the caller's vector loop
+        void renderGains(SampleType* gains, int n, float cullBelowGain)
+        {
+            int i = 0;
+            for (; i < n && isActive(); ++i)
+            {
+                gains[i] = nextGain();
+                if (cullBelowGain > 0.0f && isActive() && window.isFadingBelow(cullBelowGain))
+                    reset();
+            }
+            std::fill(gains + i, gains + n, SampleType(0));
+        }
+
+        // Same end state as renderGains() over n samples, without producing the gains
+        void advance(int n, float cullBelowGain)
+        {
+            if (n <= 0 || !isActive())
+                return;
+
+            // Culling and steal fades depend on every sample's gain: step through those
+            if (cullBelowGain > 0.0f || state == EnvelopeState::Dying)
+            {
+                for (int i = 0; i < n && isActive(); ++i)
+                {
+                    nextGain();
+                    if (cullBelowGain > 0.0f && isActive() && window.isFadingBelow(cullBelowGain))
+                        reset();
+                }
+                return;
+            }
+
+            age += std::min(n, window.getSamplesUntilEnd());
+            window.advance(n);
+
+            if (!window.isActive())
+            {
+                state = EnvelopeState::Inactive;
+                wasActive = false;
+            }
+        }
+
+        // Envelope x steal fade for the next sample; advances the voice
+        SampleType nextGain()
         {
             if (!window.isActive() && state != EnvelopeState::Dying)
             {
                 state = EnvelopeState::Inactive;
                 wasActive = false;
-                return 0.0f;
+                return SampleType(0);
             }
 
-            float val = window.process(useInputB ? inB : inA);
+            ++age;
+            SampleType val = SampleType(window.nextGain());
 
             if (state == EnvelopeState::Dying)
             {
                 if (dyingCounter > 0 && initialDyingCounter > 0)
                 {
-                    float fadeMult = dyingCounter / float(initialDyingCounter);
+                    SampleType fadeMult = dyingCounter / SampleType(initialDyingCounter);
                     val *= fadeMult;
                     if (--dyingCounter <= 0 || !window.isActive())
                     {
@@ -94,44 +175,194 @@ struct GrainGate
     void reset()
     {
         for (auto& grain : pool)
-            grain = PoolGrain();
+            grain.reset();
         nextGrainIndex = 0;
     }
 
+    // Caps polyphony, drops tails below cullGain (linear, 0 = off), picks cheap window reads for new grains
+    void setQuality(int maxGrains, float cullGain, bool useCheapWindows)
+    {
+        maxActiveGrains = juce::jlimit(1, grainsInPool, maxGrains);
+        cullBelowGain = cullGain;
+        cheapWindows = useCheapWindows;
+    }
+
+    void setCoalesceWindow(int samples) { coalesceWindow = std::max(0, samples); }
+
+    int countActive() const
+    {
+        int n = 0;
+        for (const auto& grain : pool)
+            n += grain.isActive() ? 1 : 0;
+        return n;
+    }
+
     // FIFO graceful stealing: marks oldest Active grain as Dying if needed, allocates next
-    void triggerGrain(int windowType, int windowLength, bool useInputB, double sampleRate)
+    void triggerGrain(int windowType, int windowLength, bool useInputB, double sampleRate,
+                      const WindowerParams& params = {})
     {
-        // Try to find an inactive grain
-        for (int tries = 0; tries < grainsInPool; ++tries)
+        // Coalesce: restart the youngest live grain if it started within the window
+        if (coalesceWindow > 0)
         {
-            int idx = (nextGrainIndex + tries) % grainsInPool;
-            if (!pool[idx].isActive())
+            int youngest = -1;
+            for (int idx = 0; idx < grainsInPool; ++idx)
             {
-                pool[idx].trigger(windowType, windowLength, useInputB);
-                nextGrainIndex = (idx + 1) % grainsInPool;
+                const auto& g = pool[idx];
+                if (g.state == EnvelopeState::Active && g.useInputB == useInputB && g.age < coalesceWindow
+                    && (youngest < 0 || g.age < pool[youngest].age))
+                    youngest = idx;
+            }
+
+            if (youngest >= 0)
+            {
+                pool[youngest].retrigger(windowType, windowLength, params);
                 return;
             }
         }
+
+        // Try to find an inactive grain (unless the governor's cap is reached)
+        if (maxActiveGrains >= grainsInPool || countActive() < maxActiveGrains)
+        {
+            for (int tries = 0; tries < grainsInPool; ++tries)
+            {
+                int idx = (nextGrainIndex + tries) % grainsInPool;
+                if (!pool[idx].isActive())
+                {
+                    pool[idx].trigger(windowType, windowLength, useInputB, params, cheapWindows);
+                    nextGrainIndex = (idx + 1) % grainsInPool;
+                    return;
+                }
+            }
+        }
         // All busy: gracefully mark the oldest as dying and immediately re-use
         int oldestIdx = findOldestActive();
         pool[oldestIdx].markDying(sampleRate);
-        pool[oldestIdx].trigger(windowType, windowLength, useInputB);
+        pool[oldestIdx].trigger(windowType, windowLength, useInputB, params, cheapWindows);
         nextGrainIndex = (oldestIdx + 1) % grainsInPool;
     }
 
     // Find grain to be stolen (e.g. the one that's been Active the longest)
     int findOldestActive() const
     {
-        // Simple FIFO: the nextGrainIndex* is always oldest, unless you want to add time stamps for true "longest"
-        // Here, we steal nextGrainIndex itself, but you could search for the one that's been Active the longest.
+        // Simple FIFO: grains are handed out round-robin, so the first active grain at or after
+        // nextGrainIndex is the oldest. (When the pool is full that is nextGrainIndex itself.)
+        for (int tries = 0; tries < grainsInPool; ++tries)
+        {
+            int idx = (nextGrainIndex + tries) % grainsInPool;
+            if (pool[idx].isActive())
+                return idx;
+        }
         return nextGrainIndex;
     }
 
-    float process(float inputA, float inputB)
+    SampleType process(SampleType inputA, SampleType inputB)
     {
-        float out = 0.0f;
+        SampleType out = SampleType(0);
+
+        if (cullBelowGain > 0.0f)
+        {
+            for (auto& grain : pool)
+            {
+                out += grain.process(inputA, inputB);
+                if (grain.isActive() && grain.window.isFadingBelow(cullBelowGain))
+                    grain.reset();
+            }
+            return out;
+        }
+
         for (auto& grain : pool)
             out += grain.process(inputA, inputB);
         return out;
     }
+
+    // Moves every voice on by numSamples as processBlock() would, without any audio.
+    // Voice state does not depend on the input, so this replays a trigger list cheaply
+    // (see OfflineRenderer::renderParallel).
+    void advance(int numSamples)
+    {
+        for (auto& grain : pool)
+            grain.advance(numSamples, cullBelowGain);
+    }
+
+    // Block kernel for up to one quantum without triggers
+    void processBlock(const SampleType* inputA, const SampleType* inputB, SampleType* out, int numSamples)
+    {
+        processBlock(inputA, inputB, out, numSamples, [] (int) { return quantum; });
+    }
+
+    // Block kernel for up to one quantum. fireTriggers(offset) starts every grain due at that
+    // offset and returns the offset of the next trigger (>= numSamples if none). Each voice's
+    // gains are rendered into its own row across those trigger points, so the vector
+    // multiply-add from aligned, zero-padded scratch still runs once per voice per quantum.
+    template <typename FireTriggers>
+    void processBlock(const SampleType* inputA, const SampleType* inputB, SampleType* out, int numSamples,
+                      FireTriggers&& fireTriggers)
+    {
+        jassert(numSamples > 0 && numSamples <= quantum);
+
+        std::copy(inputA, inputA + numSamples, scratchA.begin());
+        std::copy(inputB, inputB + numSamples, scratchB.begin());
+        std::fill(scratchA.begin() + numSamples, scratchA.end(), SampleType(0));
+        std::fill(scratchB.begin() + numSamples, scratchB.end(), SampleType(0));
+        juce::FloatVectorOperations::clear(accumulator.data(), quantum);
+        rowEnd.fill(0);
+
+        // Segments up to the last trigger only fill rows; the last one also flushes every row in pool order
+        for (int pos = 0; pos < numSamples;)
+        {
+            const int segmentEnd = std::min(numSamples, fireTriggers(pos));
+            jassert(segmentEnd > pos);
+
+            renderRows(pos, segmentEnd, segmentEnd == numSamples);
+            pos = segmentEnd;
+        }
+
+        std::copy(accumulator.begin(), accumulator.begin() + numSamples, out);
+    }
+
+private:
+    alignas(64) std::array<SampleType, quantum> scratchA {};
+    alignas(64) std::array<SampleType, quantum> scratchB {};
+    alignas(64) std::array<SampleType, quantum> accumulator {};
+
+    // processBlock(): per voice, its gains for this quantum so far (valid up to rowEnd, 0 = unused)
+    alignas(64) std::array<std::array<SampleType, quantum>, grainsInPool> gainRows {};
+    std::array<int, grainsInPool> rowEnd {};
+    std::array<bool, grainsInPool> rowUsesB {};
+
+    void renderRows(int from, int to, bool flush)
+    {
+        for (int idx = 0; idx < grainsInPool; ++idx)
+        {
+            auto& grain = pool[size_t(idx)];
+            auto& end = rowEnd[size_t(idx)];
+            if (!grain.isActive())
+            {
+                if (flush && end > 0)
+                    flushRow(idx);
+                continue;
+            }
+
+            if (end > 0 && rowUsesB[size_t(idx)] != grain.useInputB)
+                flushRow(idx); // Voice restarted on the other input: its earlier gains go out now
+
+            auto* row = gainRows[size_t(idx)].data();
+            std::fill(row + end, row + from, SampleType(0)); // Inactive until a trigger restarted it
+            rowUsesB[size_t(idx)] = grain.useInputB;
+            grain.renderGains(row + from, to - from, cullBelowGain);
+            end = to;
+
+            if (flush)
+                flushRow(idx);
+        }
+    }
+
+    void flushRow(int idx)
+    {
+        auto* row = gainRows[size_t(idx)].data();
+        std::fill(row + rowEnd[size_t(idx)], row + quantum, SampleType(0));
+        const SampleType* input = rowUsesB[size_t(idx)] ? scratchB.data() : scratchA.data();
+        juce::FloatVectorOperations::addWithMultiply(accumulator.data(), input, row, quantum);
+        rowEnd[size_t(idx)] = 0;
+    }
 };
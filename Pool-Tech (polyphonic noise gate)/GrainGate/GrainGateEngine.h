@@ -0,0 +1,278 @@
+#pragma once
+#include "GrainGate.h"
+#include "DualBandDetector.h"
+#include "BeatDivisionTable.h"
+#include "TimingWheel.h"
+#include "SharedSidechainAnalysis.h"
+#include "SubBlockAdapter.h"
+#include "DspArena.h"
+#include "../../TimedRandomGate.h"
+#include <iterator>
+#include <random>
+
+//==============================================================================
+/**
+    The realtime DSP chain without any plugin plumbing:
+        detector stage  (sidechain -> sorted trigger list)
+        grain stage     (trigger list -> grainGateL/R -> output)
+
+    The two stages are separate so offline renders can replay a cached trigger
+    map straight into the grain stage (see OfflineRenderer.h).
+
+    process() delays the main signal by the detector's fixed latency so grains
+    open on the transient that triggered them; render() takes audio as given.
+
+    With a shared sidechain client set (and a valid timeline stamp), the
+    detector stage reads the group's shared trigger stream instead of running
+    the local detector; envelopes are still rendered per instance. The local
+    detector does not run meanwhile, so whenever the engine falls back to it
+    (transport stopped, timeline not continuous, group left) it is reset
+    first rather than resumed from a stale state. It then needs about one
+    detector latency to warm up: transients in the last getLatencySamples()
+    before the switch were still pending in the shared detector and are lost.
+
+    Between the stages, process() routes every trigger through a timing wheel:
+    when TimedRandomGate lets a trigger be randomized it is pushed up to
+    randomness * grain length into the future, possibly into a later block.
+
+    The engine and its buffers live in a DspArena: use getFootprintBytes() to
+    size the arena and create() to place and prepare an engine in it.
+*/
+template <typename SampleType>
+struct GrainGateEngine
+{
+    DualBandDetector<SampleType> detector;
+    GrainGate<SampleType> grainGateL, grainGateR;
+
+    GrainTrigger* triggers = nullptr; // Detector output for the current block
+    int maxTriggers = 0;
+
+    // Pending (jittered) triggers on the absolute sample clock, and this block's due ones
+    static constexpr int maxPendingTriggers = 1024;
+    TimingWheel<GrainTrigger, maxPendingTriggers> wheel;
+    GrainTrigger* dueTriggers = nullptr;
+
+    // Decides per trigger whether it gets displaced (loop length in triggers, not samples)
+    static constexpr int randomGateLoop = 16;
+    TimedRandomGate randomGate { randomGateLoop };
+    std::mt19937 jitterRng { std::random_device{}() };
+
+    // Optional shared detector (owned by the processor) and the host timeline position of
+    // the current block, -1 when the transport is not running
+    SharedSidechainClient<SampleType>* sharedAnalysis = nullptr;
+    juce::int64 sharedStamp = -1;
+    bool usedSharedDetector = false; // Previous chunk came from the shared stream
+
+    // Grain stage runs in fixed, clock-aligned quanta (see GrainGate::processBlock)
+    SubBlockAdapter<GrainGate<SampleType>::quantum> subBlocks;
+
+    // Main-path delay matching the detector latency
+    SampleType* delayL = nullptr;
+    SampleType* delayR = nullptr;
+    SampleType* delayedL = nullptr;
+    SampleType* delayedR = nullptr;
+    int delaySize = 0;
+    int delayPos = 0;
+    double sampleRate = 44100.0;
+    int maxBlockSize = 512;
+
+    // Arena bytes needed by create() for this configuration, the engine itself included
+    static size_t getFootprintBytes(double newSampleRate, int newMaxBlockSize)
+    {
+        const int blockSize = std::max(1, newMaxBlockSize);
+        const int latency   = DualBandDetector<SampleType>::getLatencyForRate(newSampleRate);
+
+        return DspArena::bytesFor<GrainGateEngine>(1)
+             + DspArena::bytesFor<GrainTrigger>(size_t(triggersPerBlock(blockSize)))
+             + DspArena::bytesFor<GrainTrigger>(size_t(maxPendingTriggers))
+             + 2 * DspArena::bytesFor<SampleType>(size_t(latency))
+             + 2 * DspArena::bytesFor<SampleType>(size_t(blockSize));
+    }
+
+    // Places an engine in the arena and prepares it. Not realtime safe.
+    static GrainGateEngine& create(DspArena& arena, double newSampleRate, int newMaxBlockSize)
+    {
+        auto& engine = arena.create<GrainGateEngine>("engine (detector, grain pools, wheel)");
+        engine.prepare(newSampleRate, newMaxBlockSize, arena);
+        return engine;
+    }
+
+    void prepare(double newSampleRate, int newMaxBlockSize, DspArena& arena)
+    {
+        sampleRate   = newSampleRate;
+        maxBlockSize = std::max(1, newMaxBlockSize);
+
+        detector.prepare(sampleRate, maxBlockSize);
+        grainGateL.prepare(sampleRate);
+        grainGateR.prepare(sampleRate);
+
+        maxTriggers = triggersPerBlock(maxBlockSize);
+        triggers    = arena.allocate<GrainTrigger>(size_t(maxTriggers), "trigger lists");
+        dueTriggers = arena.allocate<GrainTrigger>(size_t(maxPendingTriggers), "trigger lists");
+        wheel.reset(0);
+        randomGate.reset();
+        subBlocks.reset();
+
+        delaySize = detector.getLatencySamples();
+        delayL    = arena.allocate<SampleType>(size_t(delaySize), "latency delay");
+        delayR    = arena.allocate<SampleType>(size_t(delaySize), "latency delay");
+        delayedL  = arena.allocate<SampleType>(size_t(maxBlockSize), "block scratch");
+        delayedR  = arena.allocate<SampleType>(size_t(maxBlockSize), "block scratch");
+        delayPos  = 0;
+    }
+
+    int getLatencySamples() const { return detector.getLatencySamples(); }
+
+    void reset()
+    {
+        detector.reset();
+        usedSharedDetector = false;
+        grainGateL.reset();
+        grainGateR.reset();
+        std::fill(delayL, delayL + delaySize, SampleType(0));
+        std::fill(delayR, delayR + delaySize, SampleType(0));
+        delayPos = 0;
+        wheel.reset(0);
+        randomGate.reset();
+        subBlocks.reset();
+    }
+
+    // Maps a QualityGovernor level onto both grain pools
+    void setQualityLevel(int level)
+    {
+        // Well below the grains still sounding; ends Hann/Blackman tails 1-2 % of a grain early
+        // (less for steeper tails), freeing the voice for the cap sooner
+        static constexpr float minus60dB = 0.001f;
+        struct Quality { int maxGrains; float cullGain; bool cheapWindows; };
+        static constexpr Quality levels[] = {
+            { GrainGate<SampleType>::grainsInPool, 0.0f,      false }, // Full
+            { 16,                                  0.0f,      false }, // CappedGrains
+            { 16,                                  minus60dB, false }, // CulledGrains
+            { 8,                                   minus60dB, true  }, // CheapWindows
+        };
+
+        const auto& q = levels[juce::jlimit(0, int(std::size(levels)) - 1, level)];
+        grainGateL.setQuality(q.maxGrains, q.cullGain, q.cheapWindows);
+        grainGateR.setQuality(q.maxGrains, q.cullGain, q.cheapWindows);
+    }
+
+    static int grainLengthSamples(const WindowerParams& params)
+    {
+        double seconds = params.grainSizeMs * 0.001;
+
+        if (params.useBeats)
+        {
+            const int div = juce::jlimit(0, int(kBeatDivisions.size()) - 1, params.beat_division);
+            seconds = kBeatDivisions[size_t(div)].gridDivision * 60.0 / std::max(1.0f, params.bpm);
+        }
+
+        return std::max(2, int(seconds * params.sampleRate));
+    }
+
+    // Grain stage: fires the (sorted, block-relative) triggers at their offsets and renders
+    void render(const SampleType* mainL, const SampleType* mainR, const SampleType* sideL, const SampleType* sideR,
+                SampleType* outL, SampleType* outR, int numSamples,
+                const GrainTrigger* blockTriggers, int numTriggers, const WindowerParams& params)
+    {
+        const int length = grainLengthSamples(params);
+        const int coalesce = int(params.coalesceMs * 0.001 * sampleRate);
+        grainGateL.setCoalesceWindow(coalesce);
+        grainGateR.setCoalesceWindow(coalesce);
+        int t = 0;
+
+        // Quantum-aligned chunks; triggers fire inside the kernel at their offsets
+        subBlocks.process(numSamples, [&] (int start, int n)
+        {
+            const auto triggersFor = [&, start] (GrainGate<SampleType>& gate, int next)
+            {
+                return [&, start, next] (int pos) mutable
+                {
+                    for (; next < numTriggers && blockTriggers[next].offset <= start + pos; ++next)
+                        gate.triggerGrain(params.windowType, length, false, sampleRate, params);
+
+                    return next < numTriggers ? blockTriggers[next].offset - start : n;
+                };
+            };
+
+            grainGateL.processBlock(mainL + start, sideL + start, outL + start, n, triggersFor(grainGateL, t));
+            grainGateR.processBlock(mainR + start, sideR + start, outR + start, n, triggersFor(grainGateR, t));
+
+            while (t < numTriggers && blockTriggers[t].offset < start + n)
+                ++t;
+        });
+    }
+
+    // Detector + grain stage, in maxBlockSize chunks so the trigger list never overflows
+    void process(const SampleType* mainL, const SampleType* mainR, const SampleType* sideL, const SampleType* sideR,
+                 SampleType* outL, SampleType* outR, int numSamples, const WindowerParams& params)
+    {
+        randomGate.setRandomness(params.randomness);
+        const int maxJitter = int(params.randomness * grainLengthSamples(params));
+
+        for (int start = 0; start < numSamples; start += maxBlockSize)
+        {
+            const int n = std::min(maxBlockSize, numSamples - start);
+            int numTriggers = -1;
+            if (sharedAnalysis != nullptr && sharedStamp >= 0)
+                numTriggers = sharedAnalysis->process(sharedStamp + start, sideL + start, sideR + start, n,
+                                                      triggers, maxTriggers);
+            const bool shared = numTriggers >= 0;
+            if (! shared)
+            {
+                if (usedSharedDetector)
+                    detector.reset();
+
+                numTriggers = detector.process(sideL + start, sideR + start, n, triggers, maxTriggers);
+            }
+            usedSharedDetector = shared;
+
+            const auto blockStart = wheel.getTime();
+            for (int t = 0; t < numTriggers; ++t)
+            {
+                int delay = 0;
+                if (maxJitter > 0 && randomGate.possiblyFlip(0))
+                    delay = std::uniform_int_distribution<int>(0, maxJitter)(jitterRng);
+
+                wheel.schedule(blockStart + triggers[t].offset + delay, triggers[t]);
+            }
+
+            int numDue = 0;
+            wheel.drain(n, [this, &numDue] (int offset, const GrainTrigger& trigger)
+            {
+                dueTriggers[numDue] = trigger;
+                dueTriggers[numDue++].offset = offset;
+            });
+
+            delayMain(mainL + start, mainR + start, n);
+            render(delayedL, delayedR, sideL + start, sideR + start,
+                   outL + start, outR + start, n, dueTriggers, numDue, params);
+        }
+    }
+
+private:
+    // Each band fires at most once per sample
+    static int triggersPerBlock(int blockSize) { return blockSize * DetectorSettings::numBands; }
+
+    void delayMain(const SampleType* inL, const SampleType* inR, int numSamples)
+    {
+        const int size = delaySize;
+        if (size == 0)
+        {
+            std::copy(inL, inL + numSamples, delayedL);
+            std::copy(inR, inR + numSamples, delayedR);
+            return;
+        }
+
+        int pos = delayPos;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            delayedL[i] = delayL[pos];
+            delayedR[i] = delayR[pos];
+            delayL[pos] = inL[i];
+            delayR[pos] = inR[i];
+            if (++pos == size)
+                pos = 0;
+        }
+        delayPos = pos;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cmath>
+
+//==============================================================================
+/**
+    Polyphase half-band FIR decimator (by 2).
+
+    Every other tap of a half-band filter is zero apart from the centre tap,
+    so each output costs one multiply for the centre plus one per odd tap pair,
+    and nothing is computed for the discarded input samples.
+
+    Group delay is fixed at `latency` samples of the input rate.
+*/
+template <typename SampleType>
+class HalfbandDecimator
+{
+public:
+    static constexpr int numTaps = 23;
+    static constexpr int centre  = (numTaps - 1) / 2;
+    static constexpr int latency = centre;
+
+    HalfbandDecimator()
+    {
+        // Blackman-windowed sinc, odd offsets only, normalised for unity DC gain
+        SampleType sum = 0;
+        for (int i = 0; i < numPairs; ++i)
+        {
+            const int k = 2 * i + 1;
+            const double sinc = std::sin(juce::MathConstants<double>::pi * k / 2.0) / (juce::MathConstants<double>::pi * k);
+            const double n = double(centre + k) / double(numTaps - 1);
+            const double w = 0.42 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * n)
+                                  + 0.08 * std::cos(4.0 * juce::MathConstants<double>::pi * n);
+            coeffs[size_t(i)] = SampleType(sinc * w);
+            sum += coeffs[size_t(i)];
+        }
+
+        for (auto& c : coeffs)
+            c *= SampleType(0.25) / sum;
+
+        reset();
+    }
+
+    void reset()
+    {
+        history.fill(SampleType(0));
+        writePos = 0;
+        phase = 0;
+    }
+
+    // Push one input sample; returns true (and fills out) on every second call
+    bool push(SampleType x, SampleType& out)
+    {
+        history[size_t(writePos)] = history[size_t(writePos + ringSize)] = x;
+        const int newest = writePos + ringSize;
+        writePos = (writePos + 1) & (ringSize - 1);
+
+        phase ^= 1;
+        if (phase != 0)
+            return false;
+
+        const SampleType* h = history.data() + newest - centre; // h[0] = x[n - centre]
+        SampleType y = SampleType(0.5) * h[0];
+        for (int i = 0; i < numPairs; ++i)
+        {
+            const int k = 2 * i + 1;
+            y += coeffs[size_t(i)] * (h[-k] + h[k]);
+        }
+
+        out = y;
+        return true;
+    }
+
+private:
+    static constexpr int numPairs = (centre + 1) / 2;
+    static constexpr int ringSize = 32; // Power of two >= numTaps, stored twice for contiguous reads
+    static_assert(ringSize >= numTaps, "ring too small");
+
+    std::array<SampleType, numPairs> coeffs {};
+    std::array<SampleType, 2 * ringSize> history {};
+    int writePos = 0;
+    int phase = 0;
+};
@@ -0,0 +1,343 @@
+#pragma once
+#include "GrainGateEngine.h"
+#include "TriggerMap.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/**
+    Offline (bounce/re-render) path, split into the engine's two stages:
+        detect()  sidechain -> TriggerMap          (cached next to the audio)
+        render()  TriggerMap -> grain pool -> out  (reruns on envelope tweaks)
+
+    detectParallel() and renderParallel() do the same on a ThreadPool, in
+    chunks, for long files (loadOrDetect() takes an optional pool too):
+      - detection: every chunk runs its own detector from preRollSeconds
+        before the chunk start and keeps only the triggers inside the chunk.
+        The detector state has converged by then, but this is not bit-exact
+        with detect(): a trigger may still differ right at a chunk start
+        (e.g. hysteresis held through a loud, continuous pre-roll).
+      - render: grain pool state depends only on the trigger list, never on
+        the audio. One serial pass replays all triggers with GrainGate::advance()
+        (envelope math only where a trigger needs it) and snapshots the pool at
+        every chunk boundary. Chunks then render in parallel from their
+        snapshots, sample-identical to render().
+*/
+struct OfflineRenderer
+{
+    static constexpr int blockSize = 4096;
+    static constexpr int parallelChunkSize = 1 << 20; // ~22 s at 48 kHz
+    static constexpr double preRollSeconds = 1.0;
+
+    static TriggerMap detect(const juce::AudioBuffer<float>& sidechain, double sampleRate,
+                             const DetectorSettings& settings)
+    {
+        return detect(sidechain, sampleRate, settings, keyFor(sidechain, sampleRate, settings));
+    }
+
+    // As above, with the map's key already computed (hashing the sidechain is a full pass)
+    static TriggerMap detect(const juce::AudioBuffer<float>& sidechain, double sampleRate,
+                             const DetectorSettings& settings, std::uint64_t key)
+    {
+        TriggerMap map;
+        map.key = key;
+
+        DualBandDetector<float> detector;
+        detector.prepare(sampleRate, blockSize);
+        detector.setSettings(settings);
+
+        // Maps store event positions, so undo the detector's fixed latency and
+        // feed that much silence at the end to flush the last triggers out.
+        const int total = sidechain.getNumSamples();
+        detectRange(detector, sidechain, 0, total + detector.getLatencySamples(), 0, total, map.entries);
+        return map;
+    }
+
+    // Chunked detect() on a thread pool (see the notes at the top)
+    static TriggerMap detectParallel(const juce::AudioBuffer<float>& sidechain, double sampleRate,
+                                     const DetectorSettings& settings, juce::ThreadPool& threadPool,
+                                     int chunkSize = parallelChunkSize)
+    {
+        return detectParallel(sidechain, sampleRate, settings, keyFor(sidechain, sampleRate, settings, threadPool),
+                              threadPool, chunkSize);
+    }
+
+    // As above, with the map's key already computed
+    static TriggerMap detectParallel(const juce::AudioBuffer<float>& sidechain, double sampleRate,
+                                     const DetectorSettings& settings, std::uint64_t key,
+                                     juce::ThreadPool& threadPool, int chunkSize = parallelChunkSize)
+    {
+        TriggerMap map;
+        map.key = key;
+
+        // Chunk and pre-roll starts stay aligned to the deepest decimation stage,
+        // so every band sees the same decimation phase as a serial run
+        constexpr int alignment = 1 << DualBandDetector<float>::maxStages;
+        chunkSize = std::max(alignment, chunkSize / alignment * alignment);
+        const int preRoll = int(preRollSeconds * sampleRate) / alignment * alignment;
+
+        const int total = sidechain.getNumSamples();
+        const int numChunks = std::max(1, (total + chunkSize - 1) / chunkSize);
+        std::vector<std::vector<TriggerMap::Entry>> chunkEntries;
+        chunkEntries.resize(size_t(numChunks));
+
+        runOnPool(threadPool, numChunks, [&] (int)
+        {
+            DualBandDetector<float> detector;
+            detector.prepare(sampleRate, blockSize);
+            detector.setSettings(settings);
+
+            return [&, detector] (int chunk) mutable
+            {
+                const int start = chunk * chunkSize;
+                const int end   = std::min(total, start + chunkSize);
+
+                detector.reset();
+                detectRange(detector, sidechain, std::max(0, start - preRoll), end + detector.getLatencySamples(),
+                            start, end, chunkEntries[size_t(chunk)]);
+            };
+        });
+
+        for (auto& entries : chunkEntries)
+            map.entries.insert(map.entries.end(), entries.begin(), entries.end());
+
+        return map;
+    }
+
+    // Runs the detector over [from, to) of the sidechain (silence past its end) and
+    // appends the events positioned in [keepFrom, keepTo), latency removed
+    static void detectRange(DualBandDetector<float>& detector, const juce::AudioBuffer<float>& sidechain,
+                            int from, int to, int keepFrom, int keepTo, std::vector<TriggerMap::Entry>& entries)
+    {
+        std::vector<GrainTrigger> blockTriggers(size_t(blockSize * DetectorSettings::numBands));
+        const std::vector<float> silence(size_t(blockSize), 0.0f);
+        const float* sideL = sidechain.getReadPointer(0);
+        const float* sideR = sidechain.getReadPointer(std::min(1, sidechain.getNumChannels() - 1));
+        const int total = sidechain.getNumSamples();
+        const int latency = detector.getLatencySamples();
+
+        for (int start = from; start < to; start += blockSize)
+        {
+            const int n = std::min(blockSize, to - start);
+            const int inFile = juce::jlimit(0, n, total - start);
+
+            int count = 0;
+            if (inFile > 0)
+                count = detector.process(sideL + start, sideR + start, inFile,
+                                         blockTriggers.data(), int(blockTriggers.size()));
+
+            appendEntries(entries, blockTriggers.data(), count, start - latency, keepFrom, keepTo);
+
+            if (inFile < n)
+            {
+                count = detector.process(silence.data(), silence.data(), n - inFile,
+                                         blockTriggers.data(), int(blockTriggers.size()));
+                appendEntries(entries, blockTriggers.data(), count, start + inFile - latency, keepFrom, keepTo);
+            }
+        }
+    }
+
+    static std::uint64_t keyFor(const juce::AudioBuffer<float>& sidechain, double sampleRate,
+                                const DetectorSettings& settings)
+    {
+        return TriggerMap::makeKey(sidechain.getArrayOfReadPointers(), sidechain.getNumChannels(),
+                                   sidechain.getNumSamples(), sampleRate, settings);
+    }
+
+    // Same key as above, with the sidechain's blocks hashed on a thread pool
+    static std::uint64_t keyFor(const juce::AudioBuffer<float>& sidechain, double sampleRate,
+                                const DetectorSettings& settings, juce::ThreadPool& threadPool)
+    {
+        const auto* const* channels = sidechain.getArrayOfReadPointers();
+        const int numChannels = sidechain.getNumChannels();
+        const int numSamples  = sidechain.getNumSamples();
+
+        std::vector<std::uint64_t> blockHashes;
+        blockHashes.resize(size_t(TriggerMap::numKeyBlocks(numSamples)));
+
+        runOnPool(threadPool, int(blockHashes.size()), [&] (int)
+        {
+            return [&] (int block)
+            {
+                blockHashes[size_t(block)] = TriggerMap::hashKeyBlock(channels, numChannels, numSamples, block);
+            };
+        });
+
+        return TriggerMap::makeKey(blockHashes, numChannels, numSamples, sampleRate, settings);
+    }
+
+    static void appendEntries(std::vector<TriggerMap::Entry>& entries, const GrainTrigger* triggers, int count,
+                              juce::int64 blockPosition, juce::int64 keepFrom, juce::int64 keepTo)
+    {
+        for (int t = 0; t < count; ++t)
+        {
+            const auto position = blockPosition + triggers[t].offset;
+            if (position >= keepFrom && position < keepTo)
+                entries.push_back({ position, std::uint32_t(triggers[t].band), triggers[t].strength });
+        }
+    }
+
+    // Reuses sidechainFile's cached map when its key still matches, otherwise detects and stores a new one.
+    // With a thread pool, both the key hash and the detection run on it (detectParallel).
+    static TriggerMap loadOrDetect(const juce::File& sidechainFile, const juce::AudioBuffer<float>& sidechain,
+                                   double sampleRate, const DetectorSettings& settings,
+                                   juce::ThreadPool* threadPool = nullptr)
+    {
+        const auto cacheFile = TriggerMap::cacheFileFor(sidechainFile);
+        const auto key = threadPool != nullptr ? keyFor(sidechain, sampleRate, settings, *threadPool)
+                                               : keyFor(sidechain, sampleRate, settings);
+
+        TriggerMap map;
+        if (map.readFrom(cacheFile, key))
+            return map;
+
+        map = threadPool != nullptr ? detectParallel(sidechain, sampleRate, settings, key, *threadPool)
+                                    : detect(sidechain, sampleRate, settings, key);
+        if (! map.writeTo(cacheFile))
+        {
+            DBG("TriggerMap: could not write cache " << cacheFile.getFullPathName());
+        }
+
+        return map;
+    }
+
+    // Grain stage only: replays the map's triggers into GrainGate::triggerGrain
+    static void render(const juce::AudioBuffer<float>& main, const juce::AudioBuffer<float>& sidechain,
+                       const TriggerMap& map, const WindowerParams& params, juce::AudioBuffer<float>& out)
+    {
+        const int total = main.getNumSamples();
+        jassert(sidechain.getNumSamples() >= total);
+        out.setSize(2, total, false, false, true);
+
+        DspArena arena;
+        arena.prepare(GrainGateEngine<float>::getFootprintBytes(params.sampleRate, blockSize));
+        auto& engine = GrainGateEngine<float>::create(arena, params.sampleRate, blockSize);
+
+        renderRange(engine, main, sidechain, map, params, out, 0, total);
+    }
+
+    // Chunked render() on a thread pool, sample-identical to it (see the notes at the top)
+    static void renderParallel(const juce::AudioBuffer<float>& main, const juce::AudioBuffer<float>& sidechain,
+                               const TriggerMap& map, const WindowerParams& params, juce::AudioBuffer<float>& out,
+                               juce::ThreadPool& threadPool, int chunkSize = parallelChunkSize)
+    {
+        const int total = main.getNumSamples();
+        jassert(sidechain.getNumSamples() >= total);
+        out.setSize(2, total, false, false, true);
+
+        chunkSize = std::max(1, chunkSize);
+        const int numChunks = std::max(1, (total + chunkSize - 1) / chunkSize);
+
+        // Serial pass: pool state at every chunk start. Both channels get the same
+        // triggers, so one pool stands in for grainGateL and grainGateR.
+        std::vector<GrainGate<float>> snapshots;
+        snapshots.resize(size_t(numChunks));
+        {
+            GrainGate<float> pool;
+            pool.prepare(params.sampleRate);
+            pool.setCoalesceWindow(int(params.coalesceMs * 0.001 * params.sampleRate));
+            const int length = GrainGateEngine<float>::grainLengthSamples(params);
+
+            juce::int64 position = 0;
+            size_t next = 0;
+            for (int chunk = 0; chunk < numChunks; ++chunk)
+            {
+                const juce::int64 chunkStart = juce::int64(chunk) * chunkSize;
+                for (; next < map.entries.size() && map.entries[next].sampleOffset < chunkStart; ++next)
+                {
+                    const auto offset = map.entries[next].sampleOffset;
+                    if (offset < 0)
+                        continue;
+
+                    pool.advance(int(offset - position));
+                    position = offset;
+                    pool.triggerGrain(params.windowType, length, false, params.sampleRate, params);
+                }
+
+                pool.advance(int(chunkStart - position));
+                position = chunkStart;
+                snapshots[size_t(chunk)] = pool;
+            }
+        }
+
+        // Parallel pass: one engine per worker, restarted from each chunk's snapshot
+        runOnPool(threadPool, numChunks, [&] (int)
+        {
+            auto arena = std::make_shared<DspArena>();
+            arena->prepare(GrainGateEngine<float>::getFootprintBytes(params.sampleRate, blockSize));
+            auto* engine = &GrainGateEngine<float>::create(*arena, params.sampleRate, blockSize);
+
+            return [&, arena, engine] (int chunk)
+            {
+                const int start = chunk * chunkSize;
+                engine->grainGateL = engine->grainGateR = snapshots[size_t(chunk)];
+                renderRange(*engine, main, sidechain, map, params, out, start, std::min(total, start + chunkSize));
+            };
+        });
+    }
+
+    // Grain stage over [from, to): replays the map's triggers in that range into the engine as it stands
+    static void renderRange(GrainGateEngine<float>& engine, const juce::AudioBuffer<float>& main,
+                            const juce::AudioBuffer<float>& sidechain, const TriggerMap& map,
+                            const WindowerParams& params, juce::AudioBuffer<float>& out, int from, int to)
+    {
+        const float* mainL = main.getReadPointer(0);
+        const float* mainR = main.getReadPointer(std::min(1, main.getNumChannels() - 1));
+        const float* sideL = sidechain.getReadPointer(0);
+        const float* sideR = sidechain.getReadPointer(std::min(1, sidechain.getNumChannels() - 1));
+
+        std::vector<GrainTrigger> blockTriggers;
+        blockTriggers.reserve(size_t(blockSize * DetectorSettings::numBands));
+
+        auto next = size_t(std::lower_bound(map.entries.begin(), map.entries.end(), juce::int64(from),
+                                            [] (const TriggerMap::Entry& e, juce::int64 pos) { return e.sampleOffset < pos; })
+                           - map.entries.begin());
+
+        for (int start = from; start < to; start += blockSize)
+        {
+            const int n = std::min(blockSize, to - start);
+
+            blockTriggers.clear();
+            for (; next < map.entries.size() && map.entries[next].sampleOffset < start + n; ++next)
+            {
+                const auto& e = map.entries[next];
+                if (e.sampleOffset >= start)
+                    blockTriggers.push_back({ int(e.sampleOffset - start), int(e.band), e.strength });
+            }
+
+            engine.render(mainL + start, mainR + start, sideL + start, sideR + start,
+                          out.getWritePointer(0, start), out.getWritePointer(1, start), n,
+                          blockTriggers.data(), int(blockTriggers.size()), params);
+        }
+    }
+
+private:
+    // Spreads jobs 0..numJobs-1 over the pool's threads and waits for all of them.
+    // makeWorker(threadIndex) runs on the calling thread and returns the per-thread job function.
+    template <typename MakeWorker>
+    static void runOnPool(juce::ThreadPool& threadPool, int numJobs, MakeWorker&& makeWorker)
+    {
+        const int numWorkers = std::max(1, std::min(numJobs, threadPool.getNumThreads()));
+        std::atomic<int> nextJob { 0 };
+        std::atomic<int> running { numWorkers };
+        juce::WaitableEvent finished;
+
+        for (int w = 0; w < numWorkers; ++w)
+        {
+            threadPool.addJob([&nextJob, &running, &finished, numJobs, job = makeWorker(w)] () mutable
+            {
+                for (int i = nextJob++; i < numJobs; i = nextJob++)
+                    job(i);
+
+                if (--running == 0)
+                    finished.signal();
+            });
+        }
+
+        finished.wait();
+    }
+};
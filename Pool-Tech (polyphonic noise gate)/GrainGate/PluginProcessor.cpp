@@ -16,6 +16,7 @@ GrainGateProcessor::GrainGateProcessor()
                       ),
       apvts(*this, nullptr, "Parameters", createParameterLayout())
 {
+    stateTable.build(*this);
 }
 
 GrainGateProcessor::~GrainGateProcessor()
@@ -77,15 +78,63 @@ bool GrainGateProcessor::isBusesLayoutSupported(const BusesLayout& layouts) cons
 
 void GrainGateProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    // Prepare your DSP here
+    governor.prepare(sampleRate);
+
+    // One arena for everything: only the engine matching the host's processing precision, plus the analyzer.
+    // Nothing is allocated after this until the next prepareToPlay.
+    const bool useDouble = isUsingDoublePrecision();
+    const size_t engineBytes = useDouble ? GrainGateEngine<double>::getFootprintBytes(sampleRate, samplesPerBlock)
+                                         : GrainGateEngine<float> ::getFootprintBytes(sampleRate, samplesPerBlock);
+    arena.prepare(engineBytes + DspArena::bytesFor<SpectrumAnalyzer>(1));
+
+    engine = nullptr;
+    doubleEngine = nullptr;
+    if (useDouble)
+    {
+        sharedAnalysis.reset();
+        if (doubleSharedAnalysis == nullptr)
+            doubleSharedAnalysis = std::make_unique<SharedSidechainClient<double>>();
+
+        doubleEngine = &GrainGateEngine<double>::create(arena, sampleRate, samplesPerBlock);
+        doubleEngine->sharedAnalysis = doubleSharedAnalysis.get();
+        setLatencySamples(doubleEngine->getLatencySamples());
+    }
+    else
+    {
+        doubleSharedAnalysis.reset();
+        if (sharedAnalysis == nullptr)
+            sharedAnalysis = std::make_unique<SharedSidechainClient<float>>();
 
-    grainGateL.prepare(sampleRate);
-    grainGateR.prepare(sampleRate);
+        engine = &GrainGateEngine<float>::create(arena, sampleRate, samplesPerBlock);
+        engine->sharedAnalysis = sharedAnalysis.get();
+        setLatencySamples(engine->getLatencySamples());
+    }
+
+    SpectrumAnalyzer::prepareShared();
+    analyzer = &arena.create<SpectrumAnalyzer>("spectrum analyzer");
+
+    DBG("GrainGate DSP memory:\n" << arena.getReport());
 }
 
-void GrainGateProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+void GrainGateProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    jassert(engine != nullptr); // prepareToPlay ran for the other precision
+    if (engine != nullptr)
+        processBlockImpl(buffer, *engine);
+}
+
+void GrainGateProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    jassert(doubleEngine != nullptr);
+    if (doubleEngine != nullptr)
+        processBlockImpl(buffer, *doubleEngine);
+}
+
+template <typename SampleType>
+void GrainGateProcessor::processBlockImpl(juce::AudioBuffer<SampleType>& buffer, GrainGateEngine<SampleType>& dsp)
 {
     juce::ScopedNoDenormals noDenormals;
+    governor.beginBlock();
 
     const int numSamples = buffer.getNumSamples();
     jassert(numSamples > 0); // Buffer should not be empty
@@ -104,16 +153,16 @@ void GrainGateProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
     jassert(sideIn.getNumChannels() >= 2);  // stereo sidechain required (if always expected)
     jassert(out.getNumChannels()   >= 2);   // stereo output required
 
-    const float* mainL  = mainIn .getReadPointer(0);  jassert(mainL  != nullptr);
-    const float* mainR  = mainIn .getReadPointer(1);  jassert(mainR  != nullptr);
+    const SampleType* mainL  = mainIn .getReadPointer(0);  jassert(mainL  != nullptr);
+    const SampleType* mainR  = mainIn .getReadPointer(1);  jassert(mainR  != nullptr);
 
     bool haveSidechain = sideIn.getNumChannels() >= 2;
-    const float* sideL  = haveSidechain ? sideIn.getReadPointer(0) : mainIn.getReadPointer(0);
-    const float* sideR  = haveSidechain ? sideIn.getReadPointer(1) : mainIn.getReadPointer(1);
+    const SampleType* sideL  = haveSidechain ? sideIn.getReadPointer(0) : mainIn.getReadPointer(0);
+    const SampleType* sideR  = haveSidechain ? sideIn.getReadPointer(1) : mainIn.getReadPointer(1);
 
-    float* outL = out.getWritePointer(0);             
+    SampleType* outL = out.getWritePointer(0);             
     jassert(outL   != nullptr);
-    float* outR = out.getWritePointer(1);             
+    SampleType* outR = out.getWritePointer(1);             
     jassert(outR   != nullptr);
 
     // --- Get project tempo and timeline info
@@ -121,6 +170,7 @@ void GrainGateProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
     double bpm = 120.0;
     double ppq = 0.0;
     bool isPlaying = false;
+    juce::int64 timeInSamples = -1;
 
     if (playHead != nullptr)
     {
@@ -130,19 +180,26 @@ void GrainGateProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
             bpm = pos->getBpm().hasValue()         ? *pos->getBpm()         : 120.0;
             ppq = pos->getPpqPosition().hasValue() ? *pos->getPpqPosition() : 0.0;
             isPlaying = pos->getIsPlaying();
+            if (isPlaying && pos->getTimeInSamples().hasValue())
+                timeInSamples = *pos->getTimeInSamples();
         }
     }
     jassert(bpm > 10.0 && bpm < 400.0); // Catch host bugs: BPM is in a sensible range
 
     // --- Collect all params, including timeline/tempo
-    GrainGateParams params;
+    WindowerParams params;
 
     // Plugin parameters from APVTS
     
-    constexpr int maxWindowTypeIndex = 3; // change to match your actual number of window types
+    constexpr int maxWindowTypeIndex = NUM_WINDOW_TYPES - 1;
     params.windowType = juce::jlimit(0, maxWindowTypeIndex, static_cast<int>(*apvts.getRawParameterValue("window_type")));
+    params.crossfade  = juce::jlimit(0.0f, 1.0f, (float) *apvts.getRawParameterValue("crossfade"));
 
     params.grainSizeMs = juce::jlimit(0.5f, 2000.0f, (float) *apvts.getRawParameterValue("grain_size"));
+    params.useBeats     = *apvts.getRawParameterValue("timebase") > 0.5f;
+    params.beat_division = static_cast<int>(*apvts.getRawParameterValue("beat_division"));
+    params.randomness   = juce::jlimit(0.0f, 1.0f, (float) *apvts.getRawParameterValue("randomness"));
+    params.coalesceMs   = juce::jlimit(0.0f, 50.0f, (float) *apvts.getRawParameterValue("coalesce_ms"));
 
     // Range checks for major params
     jassert(params.bpm > 10.0f && params.bpm < 999.0f);
@@ -167,24 +224,60 @@ void GrainGateProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
     jassert(mainL != nullptr && mainR != nullptr);
     jassert(sideL != nullptr && sideR != nullptr);
 
-    // Classic stereo: process left and right with the same plan, their own channels.
-    for (int i = 0; i < numSamples; ++i) {
-        outL[i] = grainGateL.process(mainL[i], sideL[i], params, mainPlan);
-        outR[i] = grainGateR.process(mainR[i], sideR[i], params, mainPlan);
-    }
+    // --- Detector settings (the two crosshairs)
+    DetectorSettings detector;
+    detector.bandHz[0]      = *apvts.getRawParameterValue("band1_freq");
+    detector.thresholdDb[0] = *apvts.getRawParameterValue("band1_thresh");
+    detector.bandHz[1]      = *apvts.getRawParameterValue("band2_freq");
+    detector.thresholdDb[1] = *apvts.getRawParameterValue("band2_thresh");
+    dsp.detector.setSettings(detector);
+
+    // --- Shared sidechain analysis (opt-in per group; stamps only while the transport runs)
+    dsp.sharedAnalysis->request({ static_cast<int>(*apvts.getRawParameterValue("sidechain_group")),
+                                  detector, getSampleRate(), dsp.maxBlockSize });
+    dsp.sharedStamp = timeInSamples;
+
+    // Band selector spectrum (mono sidechain; read before the main bus is overwritten in place)
+    for (int i = 0; i < numSamples; ++i)
+        analyzer->pushNextSampleIntoFifo(float(SampleType(0.5) * (sideL[i] + sideR[i])));
+
+    // Classic stereo: both channels are gated by the same sidechain triggers.
+    dsp.setQualityLevel(governor.getLevel());
+    dsp.process(mainL, mainR, sideL, sideR, outL, outR, numSamples, params);
+
+    governor.endBlock(numSamples);
 
 }
 
 void GrainGateProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // Save your parameters state
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    // Save your parameters state (compact binary, see StateBlob.h)
+    stateTable.write(destData);
+
+    if (! unreadableState.isEmpty() && destData == stateWhenUnreadable)
+        destData = unreadableState;
 }
 
 void GrainGateProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // Load your parameters state
+    // Only parameter values change here: DSP state is never re-prepared,
+    // processBlock picks the new values up on the next block.
+    unreadableState.reset();
+
+    if (StateBlob::isBlob(data, sizeInBytes))
+    {
+        if (! stateTable.read(data, sizeInBytes))
+        {
+            // Newer version or truncated: nothing was applied. Keep the blob so re-saving the
+            // session without touching anything does not overwrite it with our current values.
+            DBG("GrainGate: state blob is from a newer version or damaged, keeping current parameters");
+            unreadableState.replaceAll(data, size_t(sizeInBytes));
+            stateTable.write(stateWhenUnreadable);
+        }
+        return;
+    }
+
+    // Fallback: sessions saved before the binary format (ValueTree stream)
     auto tree = juce::ValueTree::readFromData(data, size_t(sizeInBytes));
     if (tree.isValid())
         apvts.replaceState(tree);
@@ -202,14 +295,14 @@ juce::AudioProcessorValueTreeState::ParameterLayout GrainGateProcessor::createPa
     std::vector<std::unique_ptr<RangedAudioParameter>> params;
 
     // Randomness (0 to 1)
-    params.push_back(std::make_unique<AudioParameterFloat>("randomness", "Randomness", 0.0f, 0.06f, 0.0f));
+    params.push_back(std::make_unique<AudioParameterFloat>("randomness", "Randomness", 0.0f, 1.0f, 0.0f));
 
     // Stereo Correlation (boolean toggle)
     params.push_back(std::make_unique<AudioParameterBool>("stereo_correlation", "Stereo Correlation", true));
 
     // Window Type (combobox with several window types)
-    // StringArray windowChoices { "Hann", "Blackman", "Triangle", "Rectangular" };
-    StringArray windowChoices { "Hann", "Triangle" };
+    // Order must match WindowMorphTable shape indices; append only, sessions store the index.
+    StringArray windowChoices { "Hann", "Triangle", "Blackman", "Rectangular", "Exponential" };
     params.push_back(std::make_unique<AudioParameterChoice>("window_type", "Window Type", windowChoices, 0));
 
     params.push_back(std::make_unique<AudioParameterBool>(
@@ -221,7 +314,7 @@ juce::AudioProcessorValueTreeState::ParameterLayout GrainGateProcessor::createPa
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         "grain_size", "Grain Size / Window Length", 20.0f, 250.0f, 50.0f)); // ms/beat-units depending on timebase
 
-    // Optionally, keep if still musically relevant
+    // Morphs the selected window shape towards the next one in the list
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         "crossfade", "Crossfade", 0.0f, 1.0f, 0.0f));
 
@@ -240,6 +333,23 @@ juce::AudioProcessorValueTreeState::ParameterLayout GrainGateProcessor::createPa
     params.push_back(std::make_unique<AudioParameterFloat>("sustain", "Sustain", 0.0f, 1.0f, 0.0f));
     params.push_back(std::make_unique<AudioParameterFloat>("releaseMs", "Release", 1.0f, 250.0f, 100.0f));
 
+    // Parameters added since the original set go below, in the order they were added:
+    // append only, some hosts address parameters (and their automation) by index.
+
+    // Detector bands (crosshairs): center frequency and threshold
+    NormalisableRange<float> bandRange(20.0f, 20000.0f);
+    bandRange.setSkewForCentre(1000.0f);
+    params.push_back(std::make_unique<AudioParameterFloat>("band1_freq", "Band 1 Frequency", bandRange, 80.0f));
+    params.push_back(std::make_unique<AudioParameterFloat>("band1_thresh", "Band 1 Threshold", -60.0f, 0.0f, -24.0f));
+    params.push_back(std::make_unique<AudioParameterFloat>("band2_freq", "Band 2 Frequency", bandRange, 2500.0f));
+    params.push_back(std::make_unique<AudioParameterFloat>("band2_thresh", "Band 2 Threshold", -60.0f, 0.0f, -24.0f));
+
+    // Triggers within this window of a live grain restart it (no new voice); 0 = off
+    params.push_back(std::make_unique<AudioParameterFloat>("coalesce_ms", "Trigger Coalescing", 0.0f, 50.0f, 0.0f));
+
+    // Instances in the same group (>0) keyed from the same sidechain share one detector run
+    params.push_back(std::make_unique<AudioParameterInt>("sidechain_group", "Shared Sidechain Group", 0, 16, 0));
+
     // params.push_back(std::make_unique<AudioParameterFloat>(
     //     "overlap", "Grain Overlap",
     //     NormalisableRange<float>(0.0f, 1.0f, 0.01f),
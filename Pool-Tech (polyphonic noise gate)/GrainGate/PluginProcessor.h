@@ -3,7 +3,12 @@
 #include <JuceHeader.h>
 #include "Windower.h"
 #include "GrainGate.h"
+#include "GrainGateEngine.h"
 #include "BeatDivisionTable.h" 
+#include "StateBlob.h"
+#include "QualityGovernor.h"
+#include "DspArena.h"
+#include "simplified_fft_analyzer.h"
 
 //==============================================================================
 /**
@@ -14,8 +19,8 @@ class GrainGateProcessor  : public juce::AudioProcessor
 {
 public:
     //==============================================================================
-    GranularCrossfaderProcessor();
-    ~GranularCrossfaderProcessor() override;
+    GrainGateProcessor();
+    ~GrainGateProcessor() override;
 
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
@@ -26,6 +31,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -53,6 +60,24 @@ public:
     // Accessor for AudioProcessorValueTreeState
     juce::AudioProcessorValueTreeState& getAPVTS() { return apvts; }
 
+    // Current QualityGovernor level (0 = full quality), safe to poll from any thread
+    int getQualityLevel() const { return governor.getLevel(); }
+
+    // Per-instance DSP memory, as laid out by the last prepareToPlay (message thread)
+    size_t getMemoryFootprint() const      { return arena.getUsed(); }
+    juce::String getMemoryReport() const   { return arena.getReport(); }
+
+    // Voices currently sounding on the left pool (diagnostics; read on the audio thread)
+    int getNumActiveGrains() const
+    {
+        if (engine != nullptr)       return engine->grainGateL.countActive();
+        if (doubleEngine != nullptr) return doubleEngine->grainGateL.countActive();
+        return 0;
+    }
+
+    // Sidechain spectrum for the band selector, nullptr before prepareToPlay
+    SpectrumAnalyzer* getAnalyzer()        { return analyzer; }
+
     // Factory for parameter layout setup
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
@@ -61,7 +86,34 @@ private:
 
     juce::AudioProcessorValueTreeState apvts;
 
-    static constexpr int NUM_WINDOW_TYPES = 2;
+    // All per-instance DSP state, sized and carved in prepareToPlay
+    DspArena arena;
+
+    // Detector + grainGateL/R, placed in the arena for the precision in use (the other stays null)
+    GrainGateEngine<float>*  engine = nullptr;
+    GrainGateEngine<double>* doubleEngine = nullptr;
+    SpectrumAnalyzer* analyzer = nullptr;
+
+    // Links to the process-wide shared detector for the "sidechain_group" parameter;
+    // like the engines, only the one for the precision in use exists
+    std::unique_ptr<SharedSidechainClient<float>>  sharedAnalysis;
+    std::unique_ptr<SharedSidechainClient<double>> doubleSharedAnalysis;
+
+    // Shared body of both processBlock overloads
+    template <typename SampleType>
+    void processBlockImpl (juce::AudioBuffer<SampleType>&, GrainGateEngine<SampleType>&);
+
+    // Steps grain polyphony / window quality down when a block runs over budget
+    QualityGovernor governor;
+
+    // Hash -> parameter lookup for the binary state format (built once in the constructor)
+    StateBlob::ParameterTable stateTable;
+
+    // A state this version cannot read (e.g. saved by a newer one), and what we would have saved
+    // right after failing to load it: handed back unchanged until a parameter is edited
+    juce::MemoryBlock unreadableState, stateWhenUnreadable;
+
+    static constexpr int NUM_WINDOW_TYPES = WindowMorphTable::numShapes;
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GranularCrossfaderProcessor)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GrainGateProcessor)
 };
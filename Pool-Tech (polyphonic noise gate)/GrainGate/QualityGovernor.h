@@ -0,0 +1,105 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    Adaptive quality level driven by how much of each block's realtime budget
+    processBlock used. Steps down one level at a time when over budget, and
+    back up only after a sustained period under the lower threshold.
+
+        0  Full          all grains, bilinear window reads
+        1  CappedGrains  active grains capped
+        2  CulledGrains  + grains in their tail below -60 dB are dropped
+        3  CheapWindows  + tighter cap, nearest-point window reads
+*/
+class QualityGovernor
+{
+public:
+    enum Level { Full = 0, CappedGrains, CulledGrains, CheapWindows, numLevels };
+
+    // Fraction of the block's duration spent inside processBlock
+    float stepDownLoad = 0.5f;
+    float stepUpLoad   = 0.2f;
+
+    float stepDownHoldMs = 100.0f; // Minimum time between two downward steps
+    float stepUpHoldMs   = 1000.0f; // Load must stay below stepUpLoad this long to step up
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        ticksPerSecond = double(juce::Time::getHighResolutionTicksPerSecond());
+        reset();
+    }
+
+    void reset()
+    {
+        level.store(Full, std::memory_order_relaxed);
+        smoothedLoad = 0.0f;
+        samplesSinceDown = 0;
+        samplesBelowUp = 0;
+    }
+
+    void beginBlock()
+    {
+        startTicks = juce::Time::getHighResolutionTicks();
+    }
+
+    void endBlock(int numSamples)
+    {
+        if (numSamples <= 0)
+            return;
+
+        const double elapsed = double(juce::Time::getHighResolutionTicks() - startTicks) / ticksPerSecond;
+        const double budget  = numSamples / sampleRate;
+        const float  load    = float(elapsed / budget);
+
+        // Fast attack, slow release: react to spikes, ignore single quiet blocks
+        smoothedLoad = load > smoothedLoad ? load : smoothedLoad + 0.1f * (load - smoothedLoad);
+        lastLoad.store(smoothedLoad, std::memory_order_relaxed);
+
+        samplesSinceDown += numSamples;
+        int current = level.load(std::memory_order_relaxed);
+
+        if (smoothedLoad > stepDownLoad)
+        {
+            samplesBelowUp = 0;
+            if (current < numLevels - 1 && samplesSinceDown >= msToSamples(stepDownHoldMs))
+            {
+                level.store(current + 1, std::memory_order_relaxed);
+                samplesSinceDown = 0;
+            }
+        }
+        else if (smoothedLoad < stepUpLoad && current > Full)
+        {
+            samplesBelowUp += numSamples;
+            if (samplesBelowUp >= msToSamples(stepUpHoldMs))
+            {
+                level.store(current - 1, std::memory_order_relaxed);
+                samplesBelowUp = 0;
+            }
+        }
+        else
+        {
+            samplesBelowUp = 0;
+        }
+    }
+
+    // Safe to call from any thread (logging, GUI)
+    int getLevel() const       { return level.load(std::memory_order_relaxed); }
+    float getLoad() const      { return lastLoad.load(std::memory_order_relaxed); }
+
+private:
+    double sampleRate = 44100.0;
+    double ticksPerSecond = 1.0e9;
+    juce::int64 startTicks = 0;
+
+    float smoothedLoad = 0.0f;
+    juce::int64 samplesSinceDown = 0;
+    juce::int64 samplesBelowUp = 0;
+
+    std::atomic<int> level { Full };
+    std::atomic<float> lastLoad { 0.0f };
+
+    juce::int64 msToSamples(float ms) const { return juce::int64(ms * 0.001 * sampleRate); }
+};
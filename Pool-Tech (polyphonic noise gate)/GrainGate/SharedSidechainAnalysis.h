@@ -0,0 +1,322 @@
+#pragma once
+#include "DualBandDetector.h"
+#include <juce_events/juce_events.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+/**
+    Opt-in, process-wide detector sharing.
+
+    Instances that join the same sidechain group with identical detector
+    settings (and sample rate / block size) share one Channel. Per block, the
+    first instance to arrive runs the channel's detector and publishes the
+    triggers into a small ring of slots (seqlock); the others copy them out.
+    The stamp is the host timeline position of the block, so the group is
+    only shared while the transport is running.
+
+    The channel detector is stateful, so it only ever runs on the block that
+    directly follows the last one it saw (stamp == last stamp + its length).
+    A caller whose own timeline jumped (host loop, seek, transport restart)
+    may instead restart it: the detector is reset and a new generation
+    begins, which invalidates every slot of the previous pass even if the
+    same stamps come round again. Anyone else who is neither reading a
+    published block nor continuing the stream (e.g. lagging further behind
+    than the slot ring) gets -1 and runs its own detector for that block.
+*/
+template <typename SampleType>
+class SharedSidechainAnalysis
+{
+public:
+    struct Key
+    {
+        int sourceId = 0;           // 0 = not shared
+        DetectorSettings settings;
+        double sampleRate = 0.0;
+        int maxBlockSize = 0;
+
+        bool operator== (const Key& o) const
+        {
+            return sourceId == o.sourceId && settings == o.settings
+                && sampleRate == o.sampleRate && maxBlockSize == o.maxBlockSize;
+        }
+        bool operator!= (const Key& o) const { return ! (*this == o); }
+    };
+
+    class Channel : public juce::ReferenceCountedObject
+    {
+    public:
+        explicit Channel(const Key& k)
+            : key(k)
+        {
+            detector.prepare(key.sampleRate, key.maxBlockSize);
+            detector.setSettings(key.settings);
+
+            for (auto& slot : slots)
+                slot.triggers.resize(size_t(key.maxBlockSize * DetectorSettings::numBands));
+        }
+
+        const Key key;
+
+        // Realtime safe. timelineJumped: the caller's previous stamp was not directly before this one.
+        // Returns the trigger count, or -1 if the caller should detect locally.
+        int process(juce::int64 stamp, bool timelineJumped, const SampleType* sideL, const SampleType* sideR,
+                    int numSamples, GrainTrigger* out, int maxTriggers)
+        {
+            if (stamp < 0 || numSamples > key.maxBlockSize)
+                return -1;
+
+            const int copied = read(stamp, numSamples, out, maxTriggers);
+            if (copied >= 0)
+                return copied;
+
+            if (! writerBusy.exchange(true, std::memory_order_acquire))
+            {
+                int result = read(stamp, numSamples, out, maxTriggers); // Published while we took the lock?
+                if (result < 0)
+                {
+                    const auto last = lastStamp.load(std::memory_order_relaxed);
+                    const bool continues = last >= 0 && stamp == last + lastNumSamples.load(std::memory_order_relaxed);
+
+                    if (continues || last < 0 || timelineJumped)
+                    {
+                        if (! continues)
+                        {
+                            detector.reset();
+                            generation.fetch_add(1, std::memory_order_release);
+                        }
+
+                        write(stamp, sideL, sideR, numSamples);
+                        result = read(stamp, numSamples, out, maxTriggers);
+                    }
+                }
+
+                writerBusy.store(false, std::memory_order_release);
+                return result;
+            }
+
+            // Another instance is running the detector. If it is computing exactly this block the
+            // result is a few microseconds away, and waiting for it beats falling back to a cold
+            // local detector, so spin for it with a hard bound. Otherwise don't wait at all.
+            if (writingStamp.load(std::memory_order_acquire) == stamp)
+            {
+                const auto deadline = juce::Time::getHighResolutionTicks()
+                                    + juce::Time::secondsToHighResolutionTicks(maxWaitSeconds);
+                do
+                {
+                    const int result = read(stamp, numSamples, out, maxTriggers);
+                    if (result >= 0)
+                        return result;
+                }
+                while (writingStamp.load(std::memory_order_acquire) == stamp
+                       && juce::Time::getHighResolutionTicks() < deadline);
+
+                return read(stamp, numSamples, out, maxTriggers);
+            }
+
+            return -1;
+        }
+
+    private:
+        static constexpr int numSlots = 4;
+        static constexpr double maxWaitSeconds = 100.0e-6;
+
+        struct Slot
+        {
+            std::atomic<unsigned> sequence { 0 };     // Odd while being written
+            std::atomic<unsigned> generation { 0 };
+            std::atomic<juce::int64> stamp { -1 };
+            std::atomic<int> numSamples { 0 };
+            std::atomic<int> count { 0 };
+            std::vector<GrainTrigger> triggers;
+        };
+
+        DualBandDetector<SampleType> detector;
+        std::array<Slot, numSlots> slots;
+        int nextSlot = 0;                             // Only touched by the current writer
+        std::atomic<juce::int64> lastStamp { -1 };    // Last block the detector ran on
+        std::atomic<int> lastNumSamples { 0 };
+        std::atomic<unsigned> generation { 1 };       // Bumped whenever the detector restarts
+        std::atomic<juce::int64> writingStamp { -1 }; // Block the writer is computing right now
+        std::atomic<bool> writerBusy { false };
+
+        int read(juce::int64 stamp, int numSamples, GrainTrigger* out, int maxTriggers) const
+        {
+            const auto currentGeneration = generation.load(std::memory_order_acquire);
+
+            for (const auto& slot : slots)
+            {
+                const auto before = slot.sequence.load(std::memory_order_acquire);
+                if ((before & 1) != 0 || slot.generation.load(std::memory_order_relaxed) != currentGeneration
+                    || slot.stamp.load(std::memory_order_relaxed) != stamp
+                    || slot.numSamples.load(std::memory_order_relaxed) != numSamples)
+                    continue;
+
+                const int count = std::min(maxTriggers, slot.count.load(std::memory_order_relaxed));
+                std::copy(slot.triggers.begin(), slot.triggers.begin() + count, out);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before)
+                    return count;
+            }
+            return -1;
+        }
+
+        void write(juce::int64 stamp, const SampleType* sideL, const SampleType* sideR, int numSamples)
+        {
+            writingStamp.store(stamp, std::memory_order_release);
+
+            auto& slot = slots[size_t(nextSlot)];
+            nextSlot = (nextSlot + 1) % numSlots;
+
+            slot.sequence.fetch_add(1, std::memory_order_acq_rel);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            const int count = detector.process(sideL, sideR, numSamples, slot.triggers.data(), int(slot.triggers.size()));
+            slot.generation.store(generation.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            slot.stamp.store(stamp, std::memory_order_relaxed);
+            slot.numSamples.store(numSamples, std::memory_order_relaxed);
+            slot.count.store(count, std::memory_order_relaxed);
+
+            slot.sequence.fetch_add(1, std::memory_order_release);
+            lastNumSamples.store(numSamples, std::memory_order_relaxed);
+            lastStamp.store(stamp, std::memory_order_release);
+            writingStamp.store(-1, std::memory_order_release);
+        }
+    };
+
+    using ChannelPtr = juce::ReferenceCountedObjectPtr<Channel>;
+
+    // Not realtime safe (locks, may allocate). Unused channels are dropped here.
+    static ChannelPtr acquire(const Key& key)
+    {
+        auto& r = registry();
+        const std::lock_guard<std::mutex> guard(r.mutex);
+
+        r.channels.erase(std::remove_if(r.channels.begin(), r.channels.end(),
+                                        [] (const ChannelPtr& c) { return c->getReferenceCount() == 1; }),
+                         r.channels.end());
+
+        for (auto& c : r.channels)
+            if (c->key == key)
+                return c;
+
+        r.channels.push_back(new Channel(key));
+        return r.channels.back();
+    }
+
+private:
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<ChannelPtr> channels;
+    };
+
+    static Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+};
+
+//==============================================================================
+/**
+    Per-instance link to a shared Channel. The audio thread only ever reads
+    the channel under a try-lock and flags key changes; a timer on the message
+    thread picks them up and joins/leaves (nothing is posted from the audio
+    thread, since posting a message may lock or allocate).
+*/
+template <typename SampleType>
+class SharedSidechainClient : private juce::Timer
+{
+public:
+    using Analysis = SharedSidechainAnalysis<SampleType>;
+
+    // The join/leave timer only runs while a key change is waiting to be applied
+    SharedSidechainClient() = default;
+
+    ~SharedSidechainClient() override
+    {
+        stopTimer();
+    }
+
+    // Audio thread, every block: asks to join (or leave, sourceId 0) a group. Cheap when unchanged.
+    // Settings are ignored while not shared, so automation on an unshared instance never wakes the timer.
+    void request(const typename Analysis::Key& key)
+    {
+        const auto wanted = key.sourceId > 0 ? key : typename Analysis::Key {};
+        if (wanted == requestedKey)
+            return;
+
+        const juce::SpinLock::ScopedTryLockType tryLock(lock);
+        if (! tryLock.isLocked())
+            return; // Try again next block
+
+        requestedKey = pendingKey = wanted;
+        keyChanged.store(true, std::memory_order_release);
+
+        // Only on an actual change (group, settings while shared, rate), never per block
+        if (! timerRunning.exchange(true))
+            startTimerHz(pollHz);
+    }
+
+    // Audio thread. Returns -1 if not joined (yet) or the shared result is unavailable.
+    int process(juce::int64 stamp, const SampleType* sideL, const SampleType* sideR,
+                int numSamples, GrainTrigger* out, int maxTriggers)
+    {
+        const bool jumped = previousStamp >= 0 && stamp != previousStamp + previousNumSamples;
+        previousStamp = stamp;
+        previousNumSamples = numSamples;
+
+        const juce::SpinLock::ScopedTryLockType tryLock(lock);
+        if (! tryLock.isLocked() || channel == nullptr || channel->key != requestedKey)
+            return -1;
+
+        return channel->process(stamp, jumped, sideL, sideR, numSamples, out, maxTriggers);
+    }
+
+private:
+    static constexpr int pollHz = 10;
+
+    juce::SpinLock lock;
+    typename Analysis::ChannelPtr channel;   // Guarded by lock
+    typename Analysis::Key pendingKey;       // Guarded by lock
+    typename Analysis::Key requestedKey;     // Audio thread only
+    std::atomic<bool> keyChanged { false };
+    std::atomic<bool> timerRunning { false };
+
+    // This instance's own timeline (audio thread only), to tell its jumps from other instances' lag
+    juce::int64 previousStamp = -1;
+    int previousNumSamples = 0;
+
+    void timerCallback() override
+    {
+        keyChanged.store(false, std::memory_order_release);
+
+        typename Analysis::Key key;
+        {
+            const juce::SpinLock::ScopedLockType sl(lock);
+            key = pendingKey;
+        }
+
+        typename Analysis::ChannelPtr newChannel;
+        if (key.sourceId > 0)
+            newChannel = Analysis::acquire(key);
+
+        {
+            const juce::SpinLock::ScopedLockType sl(lock);
+            std::swap(channel, newChannel);
+        }
+        // The previous channel (if any) is released here, on the message thread
+        newChannel = nullptr;
+
+        // Applied: go idle, unless another change came in meanwhile (request() saw the timer still running)
+        stopTimer();
+        timerRunning.store(false);
+        if (keyChanged.load(std::memory_order_acquire) && ! timerRunning.exchange(true))
+            startTimerHz(pollHz);
+    }
+};
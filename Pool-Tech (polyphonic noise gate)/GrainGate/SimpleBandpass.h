@@ -1,37 +1,47 @@
 #pragma once
-#include <juce_dsp/juce_dsp.h>
+#include <juce_core/juce_core.h>
+#include <cmath>
 
+// Plain biquad bandpass (same design as juce::dsp::IIR::Coefficients::makeBandPass,
+// transposed direct form II), kept free of heap-owned coefficients so it can
+// sit directly in the DSP arena.
+template <typename SampleType>
 class SimpleBandpass
 {
 public:
     SimpleBandpass() {}
 
-    void prepare(double sampleRate, int maxBlockSize)
+    void prepare(double newSampleRate, int /*maxBlockSize*/)
     {
-        juce::dsp::ProcessSpec spec;
-        spec.sampleRate = sampleRate;
-        spec.maximumBlockSize = maxBlockSize;
-        spec.numChannels = 1;
-        filter.prepare(spec);
+        sampleRate = newSampleRate;
         reset();
     }
 
     // Call this if changing frequency/Q at runtime
     void setParams(float centerHz, float Q)
     {
-        juce::dsp::IIR::Coefficients<float>::Ptr coeffs =
-            juce::dsp::IIR::Coefficients<float>::makeBandPass(sampleRate, centerHz, Q);
-        *filter.state = *coeffs;
+        const double n = 1.0 / std::tan(juce::MathConstants<double>::pi * centerHz / sampleRate);
+        const double nSquared = n * n;
+        const double invQ = 1.0 / Q;
+        const double c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+        b0 = SampleType(c1 * n * invQ);
+        b2 = -b0;
+        a1 = SampleType(c1 * 2.0 * (1.0 - nSquared));
+        a2 = SampleType(c1 * (1.0 - invQ * n + nSquared));
     }
 
     void reset()
     {
-        filter.reset();
+        s1 = s2 = SampleType(0);
     }
 
-    float processSample(float x)
+    SampleType processSample(SampleType x)
     {
-        return filter.processSample(x);
+        const SampleType y = b0 * x + s1;
+        s1 = -a1 * y + s2;   // b1 is zero for a bandpass
+        s2 = b2 * x - a2 * y;
+        return y;
     }
 
     void setSampleRate(double sr)
@@ -40,6 +50,7 @@ public:
     }
 
 private:
-    juce::dsp::IIR::Filter<float> filter;
+    SampleType b0 = SampleType(0), b2 = SampleType(0), a1 = SampleType(0), a2 = SampleType(0);
+    SampleType s1 = SampleType(0), s2 = SampleType(0);
     double sampleRate = 44100.0;
 };
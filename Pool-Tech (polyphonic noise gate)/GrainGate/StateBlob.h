@@ -0,0 +1,161 @@
+#pragma once
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//==============================================================================
+/**
+    Compact binary parameter state.
+
+    Layout (little endian, fixed size POD):
+        Header  { magic, version, numEntries }
+        Entry[] { hash of parameter ID, plain (denormalised) value }
+
+    Loading walks the entries and looks each hash up in a sorted table built
+    once per instance, so no intermediate ValueTree/XML is ever constructed.
+    Unknown hashes are skipped, missing ones keep their current value, and
+    values that already match are not touched (so the host is only told
+    about parameters that really change, like APVTS::replaceState).
+*/
+namespace StateBlob
+{
+    constexpr std::uint32_t magic   = 0x31424747; // "GGB1"
+    constexpr std::uint16_t version = 1;
+
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t numEntries;
+    };
+
+    struct Entry
+    {
+        std::uint32_t idHash;
+        float value;
+    };
+
+    static_assert (sizeof (Header) == 8, "StateBlob::Header must stay 8 bytes");
+    static_assert (sizeof (Entry)  == 8, "StateBlob::Entry must stay 8 bytes");
+
+    // 32-bit FNV-1a over the UTF-8 parameter ID
+    inline std::uint32_t hashId (const juce::String& paramID)
+    {
+        std::uint32_t h = 2166136261u;
+        for (auto* p = paramID.toRawUTF8(); *p != 0; ++p)
+        {
+            h ^= (std::uint8_t) *p;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // True if the data starts with our header (anything else goes to the ValueTree fallback)
+    inline bool isBlob (const void* data, int sizeInBytes)
+    {
+        if (data == nullptr || sizeInBytes < (int) sizeof (Header))
+            return false;
+
+        std::uint32_t m;
+        std::memcpy (&m, data, sizeof (m));
+        return juce::ByteOrder::swapIfBigEndian (m) == magic;
+    }
+
+    //==============================================================================
+    /** Sorted hash -> parameter table. Build once after the APVTS exists. */
+    class ParameterTable
+    {
+    public:
+        void build (juce::AudioProcessor& processor)
+        {
+            slots.clear();
+
+            for (auto* p : processor.getParameters())
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (p))
+                    slots.push_back ({ hashId (ranged->getParameterID()), ranged });
+
+            std::sort (slots.begin(), slots.end(),
+                       [] (const Slot& a, const Slot& b) { return a.idHash < b.idHash; });
+
+            // Two IDs hashing to the same value would silently alias each other
+            jassert (std::adjacent_find (slots.begin(), slots.end(),
+                                         [] (const Slot& a, const Slot& b) { return a.idHash == b.idHash; })
+                     == slots.end());
+        }
+
+        void write (juce::MemoryBlock& destData) const
+        {
+            const auto numEntries = (std::uint16_t) slots.size();
+            destData.setSize (sizeof (Header) + numEntries * sizeof (Entry), false);
+
+            auto* bytes = static_cast<char*> (destData.getData());
+
+            Header header { juce::ByteOrder::swapIfBigEndian (magic),
+                            juce::ByteOrder::swapIfBigEndian (version),
+                            juce::ByteOrder::swapIfBigEndian (numEntries) };
+            std::memcpy (bytes, &header, sizeof (header));
+            bytes += sizeof (header);
+
+            for (const auto& slot : slots)
+            {
+                const float plain = slot.param->convertFrom0to1 (slot.param->getValue());
+
+                Entry entry { juce::ByteOrder::swapIfBigEndian (slot.idHash),
+                              juce::ByteOrder::swapIfBigEndian (plain) };
+                std::memcpy (bytes, &entry, sizeof (entry));
+                bytes += sizeof (entry);
+            }
+        }
+
+        // Returns false (and applies nothing) if the blob is malformed or from a newer version
+        bool read (const void* data, int sizeInBytes) const
+        {
+            if (! isBlob (data, sizeInBytes))
+                return false;
+
+            auto* bytes = static_cast<const char*> (data);
+
+            Header header;
+            std::memcpy (&header, bytes, sizeof (header));
+            const auto blobVersion = juce::ByteOrder::swapIfBigEndian (header.version);
+            const auto numEntries  = juce::ByteOrder::swapIfBigEndian (header.numEntries);
+
+            if (blobVersion > version
+                || (size_t) sizeInBytes < sizeof (Header) + numEntries * sizeof (Entry))
+                return false;
+
+            bytes += sizeof (header);
+
+            for (int i = 0; i < numEntries; ++i, bytes += sizeof (Entry))
+            {
+                Entry entry;
+                std::memcpy (&entry, bytes, sizeof (entry));
+                const auto idHash = juce::ByteOrder::swapIfBigEndian (entry.idHash);
+                const auto plain  = juce::ByteOrder::swapIfBigEndian (entry.value);
+
+                auto it = std::lower_bound (slots.begin(), slots.end(), idHash,
+                                            [] (const Slot& s, std::uint32_t h) { return s.idHash < h; });
+
+                if (it == slots.end() || it->idHash != idHash)
+                    continue;
+
+                const float normalised = it->param->convertTo0to1 (plain);
+                if (normalised != it->param->getValue())
+                    it->param->setValueNotifyingHost (normalised);
+            }
+
+            return true;
+        }
+
+    private:
+        struct Slot
+        {
+            std::uint32_t idHash;
+            juce::RangedAudioParameter* param;
+        };
+
+        std::vector<Slot> slots;
+    };
+}
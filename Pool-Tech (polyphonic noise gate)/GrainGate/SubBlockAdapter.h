@@ -0,0 +1,43 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <algorithm>
+
+//==============================================================================
+/**
+    Re-blocks arbitrary host buffer sizes into fixed quanta aligned to a running
+    sample clock. A 37-sample call is processed as 32 + 5 (or 27 + 10, etc.,
+    depending on where the previous call stopped); the next call first finishes
+    the partial quantum and then continues with full ones. Every chunk is
+    processed immediately, so no latency is added.
+
+    Kernels receive at most Quantum samples and run their vector loops over the
+    full Quantum on zero-padded, aligned scratch, so there are no scalar
+    remainder loops no matter what size the host sends.
+*/
+template <int Quantum>
+class SubBlockAdapter
+{
+public:
+    static constexpr int quantum = Quantum;
+    static_assert((Quantum & (Quantum - 1)) == 0, "Quantum must be a power of two");
+
+    void reset() { position = 0; }
+
+    // Calls fn(startInBlock, numSamples) for consecutive chunks that end on quantum boundaries
+    template <typename Fn>
+    void process(int numSamples, Fn&& fn)
+    {
+        int done = 0;
+        while (done < numSamples)
+        {
+            const int phase = int(position & (Quantum - 1));
+            const int n = std::min(Quantum - phase, numSamples - done);
+            fn(done, n);
+            done += n;
+            position += n;
+        }
+    }
+
+private:
+    juce::int64 position = 0;
+};
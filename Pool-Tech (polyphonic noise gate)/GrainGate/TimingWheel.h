@@ -0,0 +1,150 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+
+//==============================================================================
+/**
+    Fixed-capacity hierarchical timing wheel for future events, keyed on an
+    absolute sample clock.
+
+        level 0: 256 slots x 1 sample       (next 256 samples)
+        level 1:  64 slots x 256 samples    (next ~16k samples)
+        level 2:  64 slots x 16384 samples  (next ~1M samples, ~21 s at 48 kHz)
+
+    schedule() is O(1); drain() walks the block sample by sample, cascading a
+    coarser slot down whenever its period starts, and hands events out in time
+    order (insertion order within a sample). All nodes live in a pool sized
+    at compile time, so nothing is allocated or sorted on the audio thread.
+*/
+template <typename Event, int Capacity = 1024>
+class TimingWheel
+{
+public:
+    static constexpr int level0Bits = 8, level1Bits = 6, level2Bits = 6;
+    static constexpr int level1Shift = level0Bits;
+    static constexpr int level2Shift = level0Bits + level1Bits;
+    static constexpr juce::int64 level0Mask = (1 << level0Bits) - 1;
+    static constexpr juce::int64 level1Mask = (1 << level1Bits) - 1;
+    static constexpr juce::int64 level2Mask = (1 << level2Bits) - 1;
+
+    // Furthest schedulable time ahead of now (one level-2 slot short of a full turn)
+    static constexpr juce::int64 horizon = level2Mask << level2Shift;
+
+    TimingWheel() { reset(0); }
+
+    void reset(juce::int64 startTime)
+    {
+        now = startTime;
+        for (auto& s : level0) s = {};
+        for (auto& s : level1) s = {};
+        for (auto& s : level2) s = {};
+
+        for (int i = 0; i < Capacity; ++i)
+            nodes[size_t(i)].next = i + 1 < Capacity ? i + 1 : -1;
+        freeHead = 0;
+        numScheduled = 0;
+    }
+
+    juce::int64 getTime() const { return now; }
+    int size() const { return numScheduled; }
+
+    // Returns false if the pool is full (the event is dropped). Past times fire at the next drain.
+    bool schedule(juce::int64 time, const Event& event)
+    {
+        if (freeHead < 0)
+            return false;
+
+        const int n = freeHead;
+        freeHead = nodes[size_t(n)].next;
+        nodes[size_t(n)].time  = juce::jlimit(now, now + horizon - 1, time);
+        nodes[size_t(n)].event = event;
+        insert(n);
+        ++numScheduled;
+        return true;
+    }
+
+    // Fires every event due in [now, now + numSamples) as fn(offsetInBlock, event), then advances now
+    template <typename Fn>
+    void drain(int numSamples, Fn&& fn)
+    {
+        for (int i = 0; i < numSamples; ++i, ++now)
+        {
+            if ((now & level0Mask) == 0)
+            {
+                if ((now & ((juce::int64(1) << level2Shift) - 1)) == 0)
+                    cascade(level2[size_t((now >> level2Shift) & level2Mask)]);
+
+                cascade(level1[size_t((now >> level1Shift) & level1Mask)]);
+            }
+
+            auto& slot = level0[size_t(now & level0Mask)];
+            int n = slot.head;
+            slot = {};
+
+            while (n >= 0)
+            {
+                const int next = nodes[size_t(n)].next;
+                fn(i, nodes[size_t(n)].event);
+                nodes[size_t(n)].next = freeHead;
+                freeHead = n;
+                --numScheduled;
+                n = next;
+            }
+        }
+    }
+
+private:
+    struct Node
+    {
+        juce::int64 time = 0;
+        Event event {};
+        int next = -1;
+    };
+
+    struct Slot
+    {
+        int head = -1, tail = -1;
+    };
+
+    std::array<Node, Capacity> nodes;
+    std::array<Slot, 1 << level0Bits> level0;
+    std::array<Slot, 1 << level1Bits> level1;
+    std::array<Slot, 1 << level2Bits> level2;
+    int freeHead = -1;
+    int numScheduled = 0;
+    juce::int64 now = 0;
+
+    void append(Slot& slot, int n)
+    {
+        nodes[size_t(n)].next = -1;
+        if (slot.tail < 0) slot.head = n;
+        else               nodes[size_t(slot.tail)].next = n;
+        slot.tail = n;
+    }
+
+    // A slot is picked by absolute time, so a level only holds events whose
+    // period is less than a full revolution ahead of the current one.
+    void insert(int n)
+    {
+        const auto t = nodes[size_t(n)].time;
+
+        if (t - now <= level0Mask)
+            append(level0[size_t(t & level0Mask)], n);
+        else if ((t >> level1Shift) - (now >> level1Shift) <= level1Mask)
+            append(level1[size_t((t >> level1Shift) & level1Mask)], n);
+        else
+            append(level2[size_t((t >> level2Shift) & level2Mask)], n);
+    }
+
+    void cascade(Slot& slot)
+    {
+        int n = slot.head;
+        slot = {};
+        while (n >= 0)
+        {
+            const int next = nodes[size_t(n)].next;
+            insert(n);
+            n = next;
+        }
+    }
+};
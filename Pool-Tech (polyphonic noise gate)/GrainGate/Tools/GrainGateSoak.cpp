@@ -0,0 +1,508 @@
+/*
+  ==============================================================================
+
+  GrainGateSoak.cpp
+
+  Soak test for GrainGateProcessor: drives the real processBlock for hours of
+  simulated audio and reports the tail of the block-time distribution rather
+  than the average, plus every heap allocation made on the audio thread.
+
+  Each block gets:
+    - a random size (tiny, power-of-two or anything up to --max-block)
+    - random automation on a random subset of parameters (every parameter
+      is touched, including choices and toggles), with occasional blocks
+      where all of them jump at once. Values go through setValue() plus
+      sendValueChangedMessageToListeners(), as the plugin wrappers do, so
+      they reach the APVTS raw values that processBlock reads
+    - a fake playhead with tempo changes, tempo jumps and transport stops
+    - main input noise; sidechain noise with gated click bursts: single
+      clicks 25-35 ms apart (about as fast as the detector's hold-off and
+      hysteresis re-arm) while grain size is pinned to its maximum
+
+  Through the sidechain the detector's re-arm rate limits a 250 ms grain
+  size to about 10 live voices, so a second stage then drives the engine's
+  grain stage (GrainGateEngine::render) directly for --saturate-minutes
+  with injected triggers every 1-16 samples, grains up to 2 s, random window
+  shapes, coalescing and quality levels: the pool stays full.
+  Both stages report their peak active voice count.
+
+  Block times go into fixed-size log histograms, so memory use does not
+  grow with the length of the run.
+
+  Build as a JUCE console application together with PluginProcessor.cpp
+  (same modules and JucePlugin_* defines as the plugin target).
+
+  Usage:
+    GrainGateSoak [--hours 1] [--saturate-minutes 10] [--rate 48000] [--max-block 2048] [--seed 1] [--double]
+
+  Exit code is 1 if anything was allocated on the audio thread.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../PluginProcessor.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+//==============================================================================
+// Allocation hook: counts operator new calls made while the current thread is armed.
+// (Direct malloc calls are not seen; everything in this codebase goes through new.)
+namespace AllocationHook
+{
+    thread_local std::atomic<juce::int64>* counter = nullptr;
+
+    struct ScopedArm
+    {
+        explicit ScopedArm(std::atomic<juce::int64>& c) { counter = &c; }
+        ~ScopedArm() { counter = nullptr; }
+    };
+
+    inline void note()
+    {
+        if (counter != nullptr)
+            counter->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline void* allocate(std::size_t size)
+    {
+        note();
+        if (auto* p = std::malloc(size != 0 ? size : 1))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    inline void* allocateAligned(std::size_t size, std::align_val_t align)
+    {
+        note();
+        const auto a = std::max(sizeof(void*), static_cast<std::size_t>(align));
+       #if JUCE_WINDOWS
+        if (auto* p = _aligned_malloc(size != 0 ? size : 1, a))
+       #else
+        if (auto* p = std::aligned_alloc(a, (std::max<std::size_t>(size, 1) + a - 1) / a * a))
+       #endif
+            return p;
+        throw std::bad_alloc();
+    }
+
+    inline void freeAligned(void* p) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+}
+
+void* operator new  (std::size_t size)                          { return AllocationHook::allocate(size); }
+void* operator new[](std::size_t size)                          { return AllocationHook::allocate(size); }
+void* operator new  (std::size_t size, std::align_val_t a)      { return AllocationHook::allocateAligned(size, a); }
+void* operator new[](std::size_t size, std::align_val_t a)      { return AllocationHook::allocateAligned(size, a); }
+void  operator delete  (void* p) noexcept                       { std::free(p); }
+void  operator delete[](void* p) noexcept                       { std::free(p); }
+void  operator delete  (void* p, std::size_t) noexcept          { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept          { std::free(p); }
+void  operator delete  (void* p, std::align_val_t) noexcept     { AllocationHook::freeAligned(p); }
+void  operator delete[](void* p, std::align_val_t) noexcept     { AllocationHook::freeAligned(p); }
+void  operator delete  (void* p, std::size_t, std::align_val_t) noexcept { AllocationHook::freeAligned(p); }
+void  operator delete[](void* p, std::size_t, std::align_val_t) noexcept { AllocationHook::freeAligned(p); }
+
+//==============================================================================
+// Host timeline as seen by processBlock
+struct SoakPlayHead : public juce::AudioPlayHead
+{
+    double bpm = 120.0;
+    double sampleRate = 48000.0;
+    juce::int64 timeInSamples = 0;
+    double ppq = 0.0;
+    bool playing = true;
+
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setBpm(bpm);
+        info.setTimeInSamples(timeInSamples);
+        info.setPpqPosition(ppq);
+        info.setIsPlaying(playing);
+        return info;
+    }
+
+    void advance(int numSamples)
+    {
+        if (! playing)
+            return;
+
+        timeInSamples += numSamples;
+        ppq += numSamples / sampleRate * bpm / 60.0;
+    }
+};
+
+//==============================================================================
+struct SoakSettings
+{
+    double hours = 1.0;
+    double saturateMinutes = 10.0;
+    double sampleRate = 48000.0;
+    int maxBlock = 2048;
+    unsigned seed = 1;
+    bool doublePrecision = false;
+};
+
+// Log-spaced histogram over 8 decades above minValue. Percentiles are bin upper edges (~5 % resolution).
+struct LogHistogram
+{
+    static constexpr int binsPerDecade = 50;
+    static constexpr int numBins = 8 * binsPerDecade + 1; // Bin 0 holds everything <= minValue
+
+    explicit LogHistogram(double minimum) : minValue(minimum) {}
+
+    void add(double value)
+    {
+        int bin = 0;
+        if (value > minValue)
+            bin = juce::jlimit(1, numBins - 1, int(std::ceil(std::log10(value / minValue) * binsPerDecade)));
+
+        ++bins[size_t(bin)];
+        ++count;
+        maxValue = std::max(maxValue, value);
+    }
+
+    double percentile(double q) const
+    {
+        const auto target = std::max<juce::int64>(1, juce::int64(std::ceil(q * double(count))));
+        juce::int64 cumulative = 0;
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            cumulative += bins[size_t(bin)];
+            if (cumulative >= target)
+                return std::min(maxValue, minValue * std::pow(10.0, bin / double(binsPerDecade)));
+        }
+        return maxValue;
+    }
+
+    const double minValue;
+    std::array<juce::int64, numBins> bins {};
+    juce::int64 count = 0;
+    double maxValue = 0.0;
+};
+
+struct SoakStats
+{
+    LogHistogram blockMicros { 0.01 };  // Wall time of each processBlock
+    LogHistogram blockLoad   { 1.0e-5 }; // Same, as a fraction of the block's realtime duration
+    std::atomic<juce::int64> processAllocations { 0 };
+    std::atomic<juce::int64> automationAllocations { 0 };
+    juce::int64 levelBlocks[QualityGovernor::numLevels] {};
+    juce::int64 automationEvents = 0;
+    juce::int64 rawValueChanges = 0;    // Automation events that reached the APVTS raw value
+    int peakActiveGrains = 0;
+    int worstBlockSize = 0;
+    double worstMicros = 0.0;
+};
+
+// One host-style automation event
+static void automate(juce::AudioProcessorParameter& param, float normalisedValue)
+{
+    param.setValue(normalisedValue);
+    param.sendValueChangedMessageToListeners(normalisedValue);
+}
+
+template <typename SampleType>
+static void runSoak(GrainGateProcessor& processor, const SoakSettings& settings, SoakStats& stats)
+{
+    std::mt19937 rng(settings.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto chance = [&] (float p) { return unit(rng) < p; };
+
+    SoakPlayHead playHead;
+    playHead.sampleRate = settings.sampleRate;
+    processor.setPlayHead(&playHead);
+
+    // Stereo main + stereo sidechain in, stereo out
+    auto layout = processor.getBusesLayout();
+    layout.inputBuses.getReference(1) = juce::AudioChannelSet::stereo();
+    if (! processor.setBusesLayout(layout))
+        std::printf("warning: sidechain bus could not be enabled\n");
+
+    processor.setProcessingPrecision(settings.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                              : juce::AudioProcessor::singlePrecision);
+    processor.setRateAndBufferSizeDetails(settings.sampleRate, settings.maxBlock);
+    processor.prepareToPlay(settings.sampleRate, settings.maxBlock);
+
+    juce::AudioBuffer<SampleType> buffer(processor.getTotalNumInputChannels(), settings.maxBlock);
+    juce::MidiBuffer midi;
+
+    // Every parameter with the raw value processBlock reads for it
+    struct Automated
+    {
+        juce::AudioProcessorParameter* param;
+        std::atomic<float>* raw;
+    };
+    std::vector<Automated> parameters;
+    for (auto* p : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(p))
+            parameters.push_back({ p, processor.getAPVTS().getRawParameterValue(ranged->paramID) });
+
+    auto* grainSize = processor.getAPVTS().getParameter("grain_size");
+    auto* timebase  = processor.getAPVTS().getParameter("timebase");
+    jassert(grainSize != nullptr && timebase != nullptr);
+
+    const auto totalSamples = juce::int64(settings.hours * 3600.0 * settings.sampleRate);
+    const auto progressEvery = juce::int64(600.0 * settings.sampleRate); // Every 10 simulated minutes
+    const double ticksPerMicro = double(juce::Time::getHighResolutionTicksPerSecond()) * 1.0e-6;
+
+
+    juce::int64 done = 0, nextProgress = progressEvery;
+    int burstRemaining = 0, burstSpacing = 1, burstPhase = 0;
+
+    while (done < totalSamples)
+    {
+        // --- Block size: tiny, power of two, or anything up to the maximum
+        int numSamples;
+        const float pick = unit(rng);
+        if (pick < 0.25f)      numSamples = 1 + int(rng() % 32u);
+        else if (pick < 0.5f)  numSamples = std::min(settings.maxBlock, 1 << int(rng() % 12u));
+        else                   numSamples = 1 + int(rng() % unsigned(settings.maxBlock));
+
+        // --- Timeline: slow drifts, occasional jumps and transport stops
+        if (chance(0.01f))   playHead.bpm = juce::jlimit(40.0, 300.0, playHead.bpm * (0.97 + 0.06 * unit(rng)));
+        if (chance(0.001f))  playHead.bpm = 40.0 + 260.0 * unit(rng);
+        if (chance(0.0005f)) playHead.playing = ! playHead.playing;
+
+        // --- Input: noise, plus gated click bursts on the sidechain that saturate the pool
+        if (burstRemaining <= 0 && chance(0.002f))
+        {
+            burstRemaining = int(settings.sampleRate * (2.0 + 4.0 * unit(rng)));
+            burstSpacing = int(settings.sampleRate * (0.025 + 0.01 * unit(rng)));
+            burstPhase = 0;
+        }
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+            const bool sidechain = ch >= 2;
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = SampleType((unit(rng) * 2.0f - 1.0f) * (sidechain ? 0.01f : 0.5f));
+        }
+
+        if (burstRemaining > 0)
+        {
+            for (int i = 0; i < numSamples; ++i, ++burstPhase)
+                if (burstPhase % burstSpacing == 0)
+                    for (int ch = 2; ch < buffer.getNumChannels(); ++ch)
+                        buffer.setSample(ch, i, SampleType(1));
+
+            burstRemaining -= numSamples;
+        }
+
+        // --- Automation, applied on the audio thread as a host would
+        {
+            AllocationHook::ScopedArm arm(stats.automationAllocations);
+            const bool jumpAll = chance(0.001f);
+            for (auto& a : parameters)
+            {
+                if (jumpAll || chance(0.05f))
+                {
+                    const float before = a.raw->load();
+                    automate(*a.param, unit(rng));
+                    ++stats.automationEvents;
+                    stats.rawValueChanges += a.raw->load() != before ? 1 : 0;
+                }
+            }
+
+            // Long grains in milliseconds while a burst runs, or the pool never fills
+            if (burstRemaining > 0)
+            {
+                automate(*grainSize, 1.0f);
+                automate(*timebase, 0.0f);
+            }
+        }
+
+        // --- The block itself
+        juce::AudioBuffer<SampleType> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+        const auto start = juce::Time::getHighResolutionTicks();
+        {
+            AllocationHook::ScopedArm arm(stats.processAllocations);
+            processor.processBlock(block, midi);
+        }
+        const double micros = double(juce::Time::getHighResolutionTicks() - start) / ticksPerMicro;
+
+        stats.blockMicros.add(micros);
+        stats.blockLoad.add(micros * 1.0e-6 * settings.sampleRate / numSamples);
+        stats.peakActiveGrains = std::max(stats.peakActiveGrains, processor.getNumActiveGrains());
+        ++stats.levelBlocks[juce::jlimit(0, QualityGovernor::numLevels - 1, processor.getQualityLevel())];
+        if (micros > stats.worstMicros)
+        {
+            stats.worstMicros = micros;
+            stats.worstBlockSize = numSamples;
+        }
+
+        playHead.advance(numSamples);
+        done += numSamples;
+
+        if (done >= nextProgress)
+        {
+            std::printf("  %6.1f min simulated, %lld allocations so far\n", done / settings.sampleRate / 60.0,
+                        (long long) stats.processAllocations.load());
+            std::fflush(stdout);
+            nextProgress += progressEvery;
+        }
+    }
+
+    processor.releaseResources();
+    processor.setPlayHead(nullptr);
+}
+
+// Grain stage only, with triggers injected straight into render() so the pool stays saturated
+template <typename SampleType>
+static void runSaturationSoak(const SoakSettings& settings, SoakStats& stats)
+{
+    std::mt19937 rng(settings.seed + 1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    DspArena arena;
+    arena.prepare(GrainGateEngine<SampleType>::getFootprintBytes(settings.sampleRate, settings.maxBlock));
+    auto& engine = GrainGateEngine<SampleType>::create(arena, settings.sampleRate, settings.maxBlock);
+
+    std::vector<SampleType> main(size_t(settings.maxBlock)), side(size_t(settings.maxBlock));
+    std::vector<SampleType> outL(size_t(settings.maxBlock)), outR(size_t(settings.maxBlock));
+    std::vector<GrainTrigger> triggers(size_t(settings.maxBlock));
+    for (size_t i = 0; i < main.size(); ++i)
+    {
+        main[i] = SampleType(unit(rng) - 0.5f);
+        side[i] = SampleType(unit(rng) - 0.5f);
+    }
+
+    WindowerParams params;
+    params.sampleRate = settings.sampleRate;
+    params.attackMs = 5.0f;
+    params.decayMs = 50.0f;
+    params.sustain = 0.7f;
+    params.releaseMs = 100.0f;
+
+    const auto totalSamples = juce::int64(settings.saturateMinutes * 60.0 * settings.sampleRate);
+    const double ticksPerMicro = double(juce::Time::getHighResolutionTicksPerSecond()) * 1.0e-6;
+    int spacing = 1, phase = 0;
+
+    for (juce::int64 done = 0; done < totalSamples;)
+    {
+        const int numSamples = 1 + int(rng() % unsigned(settings.maxBlock));
+
+        // New grain setup every ~0.1 s
+        if (unit(rng) < numSamples / float(0.1 * settings.sampleRate))
+        {
+            const int shape = int(rng() % 6u);
+            params.windowType  = shape == 5 ? 10 : shape;
+            params.crossfade   = unit(rng);
+            params.grainSizeMs = 50.0f + 1950.0f * unit(rng);
+            params.coalesceMs  = unit(rng) < 0.5f ? 0.0f : 50.0f * unit(rng);
+            engine.setQualityLevel(int(rng() % unsigned(QualityGovernor::numLevels)));
+            spacing = 1 + int(rng() % 16u);
+        }
+
+        int numTriggers = 0;
+        for (int i = 0; i < numSamples; ++i, ++phase)
+            if (phase % spacing == 0)
+                triggers[size_t(numTriggers++)] = { i, 0, 1.0f };
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        {
+            AllocationHook::ScopedArm arm(stats.processAllocations);
+            engine.render(main.data(), main.data(), side.data(), side.data(), outL.data(), outR.data(),
+                          numSamples, triggers.data(), numTriggers, params);
+        }
+        const double micros = double(juce::Time::getHighResolutionTicks() - start) / ticksPerMicro;
+
+        stats.blockMicros.add(micros);
+        stats.blockLoad.add(micros * 1.0e-6 * settings.sampleRate / numSamples);
+        stats.peakActiveGrains = std::max(stats.peakActiveGrains, engine.grainGateL.countActive());
+        if (micros > stats.worstMicros)
+        {
+            stats.worstMicros = micros;
+            stats.worstBlockSize = numSamples;
+        }
+
+        done += numSamples;
+    }
+}
+
+static void printTimings(const char* name, const SoakStats& stats)
+{
+    std::printf("\n%s: %lld blocks\n", name, (long long) stats.blockMicros.count);
+    std::printf("block time (us)  p50 %9.2f  p99 %9.2f  p99.9 %9.2f  max %9.2f (block of %d)\n",
+                stats.blockMicros.percentile(0.5), stats.blockMicros.percentile(0.99),
+                stats.blockMicros.percentile(0.999), stats.worstMicros, stats.worstBlockSize);
+    std::printf("realtime load    p50 %9.4f  p99 %9.4f  p99.9 %9.4f  max %9.4f\n",
+                stats.blockLoad.percentile(0.5), stats.blockLoad.percentile(0.99),
+                stats.blockLoad.percentile(0.999), stats.blockLoad.maxValue);
+    std::printf("peak active grains: %d of %d\n", stats.peakActiveGrains, GrainGate<float>::grainsInPool);
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    juce::ArgumentList args(argc, argv);
+
+    SoakSettings settings;
+    if (args.containsOption("--hours"))     settings.hours      = args.getValueForOption("--hours").getDoubleValue();
+    if (args.containsOption("--saturate-minutes"))
+        settings.saturateMinutes = args.getValueForOption("--saturate-minutes").getDoubleValue();
+    if (args.containsOption("--rate"))      settings.sampleRate = args.getValueForOption("--rate").getDoubleValue();
+    if (args.containsOption("--max-block")) settings.maxBlock   = std::max(1, args.getValueForOption("--max-block").getIntValue());
+    if (args.containsOption("--seed"))      settings.seed       = (unsigned) args.getValueForOption("--seed").getIntValue();
+    settings.doublePrecision = args.containsOption("--double");
+
+    std::printf("GrainGate soak: %.2f h at %.0f Hz, blocks 1..%d, %s precision, seed %u\n",
+                settings.hours, settings.sampleRate, settings.maxBlock,
+                settings.doublePrecision ? "double" : "single", settings.seed);
+
+    SoakStats stats, saturated;
+    {
+        GrainGateProcessor processor;
+        if (settings.doublePrecision) runSoak<double>(processor, settings, stats);
+        else                          runSoak<float> (processor, settings, stats);
+    }
+
+    if (settings.doublePrecision) runSaturationSoak<double>(settings, saturated);
+    else                          runSaturationSoak<float> (settings, saturated);
+
+    printTimings("processBlock", stats);
+    std::printf("automation: %lld events, %lld reached processBlock's raw values\n",
+                (long long) stats.automationEvents, (long long) stats.rawValueChanges);
+
+    std::printf("quality levels (blocks):");
+    for (auto n : stats.levelBlocks)
+        std::printf(" %lld", (long long) n);
+    std::printf("\n");
+
+    printTimings("grain stage, saturated", saturated);
+
+    const auto processAllocs    = stats.processAllocations.load() + saturated.processAllocations.load();
+    const auto automationAllocs = stats.automationAllocations.load();
+    std::printf("\naudio-thread allocations: processBlock/render %lld, parameter automation %lld\n",
+                (long long) processAllocs, (long long) automationAllocs);
+
+    bool failed = false;
+    if (processAllocs + automationAllocs > 0)
+    {
+        std::printf("FAIL: heap allocation on the audio thread\n");
+        failed = true;
+    }
+
+    if (stats.automationEvents > 0 && stats.rawValueChanges == 0)
+    {
+        std::printf("FAIL: automation never reached the parameter values processBlock reads\n");
+        failed = true;
+    }
+
+    return failed ? 1 : 0;
+}
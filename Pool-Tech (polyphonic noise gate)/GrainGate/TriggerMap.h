@@ -0,0 +1,178 @@
+#pragma once
+#include "DualBandDetector.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//==============================================================================
+/**
+    Detector output for a whole sidechain: a sorted list of absolute sample
+    offsets with band and strength, stored next to the audio file.
+
+    File layout (little endian):
+        Header  { magic, version, reserved, key, numEntries }
+        Entry[] { sample offset, band, strength }
+
+    The key hashes the sidechain content together with the detector settings,
+    sample rate and detector revision, so a stale map is never replayed. Envelope-only changes
+    (window type, grain size, ADSR) keep the key and reuse the map.
+*/
+struct TriggerMap
+{
+    static constexpr std::uint32_t magic   = 0x4D544747; // "GGTM"
+    static constexpr std::uint16_t version = 1;
+
+    struct Entry
+    {
+        std::int64_t sampleOffset;
+        std::uint32_t band;
+        float strength;
+    };
+    static_assert (sizeof (Entry) == 16, "TriggerMap::Entry must stay 16 bytes");
+
+    std::uint64_t key = 0;
+    std::vector<Entry> entries; // Sorted by sampleOffset
+
+    //==============================================================================
+    // The audio is hashed in blocks of this many samples, then the block hashes are
+    // mixed in order, so a thread pool can hash the blocks (see OfflineRenderer::keyFor)
+    static constexpr std::int64_t keyBlockSize = 1 << 20;
+
+    static int numKeyBlocks(std::int64_t numSamples)
+    {
+        return int((numSamples + keyBlockSize - 1) / keyBlockSize);
+    }
+
+    // Hash of every channel's samples in block `block`
+    static std::uint64_t hashKeyBlock(const float* const* sidechain, int numChannels, std::int64_t numSamples, int block)
+    {
+        Fnv hash;
+        const auto from = std::int64_t(block) * keyBlockSize;
+        const auto to   = std::min(numSamples, from + keyBlockSize);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (auto i = from; i < to; ++i)
+                hash.mixFloat(sidechain[ch][i]);
+
+        return hash.h;
+    }
+
+    static std::uint64_t makeKey(const float* const* sidechain, int numChannels, std::int64_t numSamples,
+                                 double sampleRate, const DetectorSettings& settings)
+    {
+        std::vector<std::uint64_t> blockHashes;
+        for (int b = 0; b < numKeyBlocks(numSamples); ++b)
+            blockHashes.push_back(hashKeyBlock(sidechain, numChannels, numSamples, b));
+
+        return makeKey(blockHashes, numChannels, numSamples, sampleRate, settings);
+    }
+
+    // As above, from the hashKeyBlock() results for blocks 0..numKeyBlocks(numSamples)-1
+    static std::uint64_t makeKey(const std::vector<std::uint64_t>& blockHashes, int numChannels, std::int64_t numSamples,
+                                 double sampleRate, const DetectorSettings& settings)
+    {
+        jassert(int(blockHashes.size()) == numKeyBlocks(numSamples));
+
+        // FNV-1a style mix over 32-bit words: every setting, then the audio's block hashes
+        Fnv hash;
+        hash.mix(DualBandDetector<float>::revision);
+        hash.mix(std::uint32_t(numChannels));
+        hash.mix64(std::uint64_t(numSamples));
+        hash.mixFloat(float(sampleRate));
+
+        for (int b = 0; b < DetectorSettings::numBands; ++b)
+        {
+            hash.mixFloat(settings.bandHz[size_t(b)]);
+            hash.mixFloat(settings.thresholdDb[size_t(b)]);
+        }
+        hash.mixFloat(settings.q);
+        hash.mixFloat(settings.releaseMs);
+        hash.mixFloat(settings.holdMs);
+        hash.mixFloat(settings.rearmDb);
+
+        for (auto blockHash : blockHashes)
+            hash.mix64(blockHash);
+
+        return hash.h;
+    }
+
+    // e.g. "kick.wav" -> "kick.wav.graingate-triggers" (keeps kick.wav and kick.aif apart)
+    static juce::File cacheFileFor(const juce::File& audioFile)
+    {
+        return audioFile.getSiblingFile(audioFile.getFileName() + ".graingate-triggers");
+    }
+
+    //==============================================================================
+    bool writeTo(const juce::File& file) const
+    {
+        juce::TemporaryFile temp(file);
+        {
+            juce::FileOutputStream out(temp.getFile());
+            if (! out.openedOk())
+                return false;
+
+            out.writeInt((int) magic);
+            out.writeShort((short) version);
+            out.writeShort(0);
+            out.writeInt64((juce::int64) key);
+            out.writeInt64((juce::int64) entries.size());
+
+            for (const auto& e : entries)
+            {
+                out.writeInt64(e.sampleOffset);
+                out.writeInt((int) e.band);
+                out.writeFloat(e.strength);
+            }
+
+            out.flush();
+            if (out.getStatus().failed())
+                return false;
+        }
+        return temp.overwriteTargetFileWithTemporary();
+    }
+
+    // Fails (and leaves this map empty) if the file is missing, malformed or keyed differently
+    bool readFrom(const juce::File& file, std::uint64_t expectedKey)
+    {
+        entries.clear();
+        key = 0;
+
+        juce::FileInputStream in(file);
+        if (! in.openedOk())
+            return false;
+
+        if ((std::uint32_t) in.readInt() != magic || (std::uint16_t) in.readShort() > version)
+            return false;
+
+        in.readShort(); // reserved
+        if ((std::uint64_t) in.readInt64() != expectedKey)
+            return false;
+
+        const auto numEntries = in.readInt64();
+        if (numEntries < 0 || numEntries * (juce::int64) sizeof(Entry) > in.getNumBytesRemaining())
+            return false;
+
+        entries.resize(size_t(numEntries));
+        for (auto& e : entries)
+        {
+            e.sampleOffset = in.readInt64();
+            e.band         = (std::uint32_t) in.readInt();
+            e.strength     = in.readFloat();
+        }
+
+        key = expectedKey;
+        return true;
+    }
+
+private:
+    struct Fnv
+    {
+        std::uint64_t h = 14695981039346656037ull;
+
+        void mix(std::uint32_t word)     { h ^= word; h *= 1099511628211ull; }
+        void mix64(std::uint64_t word)   { mix(std::uint32_t(word)); mix(std::uint32_t(word >> 32)); }
+        void mixFloat(float f)           { std::uint32_t w; std::memcpy(&w, &f, sizeof(w)); mix(w); }
+    };
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//==============================================================================
+/**
+    Precomputed window shapes and the morphs between neighbouring shapes.
+
+    Pair p blends shape p (morph = 0) into shape (p + 1) % numShapes (morph = 1),
+    so a single crossfade knob sweeps Hann -> Triangle -> Blackman -> ...
+    Reads are bilinear over (morph, phase); a grain resolves its two morph rows
+    once at trigger time, so the per-sample cost is one interpolated lookup.
+
+    The table is shared by every instance and built on first use (prepare()).
+*/
+class WindowMorphTable
+{
+public:
+    static constexpr int numShapes  = 5;    // Hann, Triangle, Blackman, Rectangular, Exponential
+    static constexpr int morphSteps = 9;    // rows along the morph axis, per pair
+    static constexpr int phaseSteps = 1024; // intervals along the phase axis
+    static constexpr int rowSize    = phaseSteps + 2; // +1 end point, +1 guard for the right neighbour
+
+    static const WindowMorphTable& get()
+    {
+        static const WindowMorphTable instance;
+        return instance;
+    }
+
+    /** Two neighbouring morph rows plus the blend between them, resolved once per grain. */
+    struct Cursor
+    {
+        const float* rowA = nullptr;
+        const float* rowB = nullptr;
+        float morphFrac = 0.0f;
+        float peakPos = 0.0f; // Later of the two rows' peaks: a rough "past the rise" marker for culling
+
+        // tablePos is phase * phaseSteps
+        float read(float tablePos) const noexcept
+        {
+            const int   i    = std::min(int(tablePos), phaseSteps);
+            const float frac = tablePos - float(i);
+            const float a = rowA[i] + frac * (rowA[i + 1] - rowA[i]);
+            const float b = rowB[i] + frac * (rowB[i + 1] - rowB[i]);
+            return a + morphFrac * (b - a);
+        }
+
+        // Quality fallback: nearest morph row, nearest phase point, no interpolation
+        float readNearest(float tablePos) const noexcept
+        {
+            return (morphFrac < 0.5f ? rowA : rowB)[int(tablePos + 0.5f)];
+        }
+
+        // Table point i of the curve a grain reads: interpolated between the rows, or the nearest row.
+        // Equal to read()/readNearest() at that point.
+        float pointAt(int i, bool nearest) const noexcept
+        {
+            if (nearest)
+                return (morphFrac < 0.5f ? rowA : rowB)[i];
+            return rowA[i] + morphFrac * (rowB[i] - rowA[i]);
+        }
+
+        // One linear scan of that curve: the first point that reaches gain (the curve's maximum if
+        // none does), so morphs with two peaks land on the earliest edge. peak receives the
+        // position of the curve's first maximum.
+        int findFirstPointReaching(float gain, bool nearest, int& peak) const noexcept
+        {
+            int found = -1;
+            float highest = pointAt(0, nearest);
+            peak = 0;
+
+            for (int i = 0; i <= phaseSteps; ++i)
+            {
+                const float value = pointAt(i, nearest);
+                if (found < 0 && value >= gain)
+                    found = i;
+                if (value > highest)
+                {
+                    highest = value;
+                    peak = i;
+                }
+            }
+            return found >= 0 ? found : peak;
+        }
+    };
+
+    Cursor getCursor(int shape, float morph) const noexcept
+    {
+        shape = juce::jlimit(0, numShapes - 1, shape);
+        const float m  = juce::jlimit(0.0f, 1.0f, morph) * float(morphSteps - 1);
+        const int   m0 = std::min(int(m), morphSteps - 2);
+
+        const int rA = shape * morphSteps + m0;
+        return { row(shape, m0), row(shape, m0 + 1), m - float(m0), std::max(peaks[size_t(rA)], peaks[size_t(rA + 1)]) };
+    }
+
+    // Phase 0..1, morph 0..1
+    float lookup(int shape, float morph, float phase) const noexcept
+    {
+        return getCursor(shape, morph).read(juce::jlimit(0.0f, 1.0f, phase) * float(phaseSteps));
+    }
+
+    // Reference shapes, used to fill the table
+    static float evaluateShape(int type, float phase)
+    {
+        switch (type)
+        {
+            case 0: // Hann
+                return 0.5f * (1.0f - std::cos(juce::MathConstants<float>::twoPi * phase));
+            case 1: // Triangle
+                return 1.0f - std::abs(2.0f * phase - 1.0f);
+            case 2: // Blackman
+                return 0.42f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * phase)
+                             + 0.08f * std::cos(2.0f * juce::MathConstants<float>::twoPi * phase);
+            case 3: // Rectangular
+                return 1.0f;
+            case 4: // Exponential
+                return phase <= 1.0f ? std::exp(-4.0f * (1.0f - phase)) : 0.0f;
+            default:
+                return 1.0f;
+        }
+    }
+
+private:
+    std::vector<float> data;
+    std::vector<float> peaks; // Per row: table position of the first maximum
+
+    WindowMorphTable()
+        : data(size_t(numShapes * morphSteps * rowSize)),
+          peaks(size_t(numShapes * morphSteps))
+    {
+        for (int shape = 0; shape < numShapes; ++shape)
+        {
+            const int next = (shape + 1) % numShapes;
+
+            for (int m = 0; m < morphSteps; ++m)
+            {
+                const float morph = m / float(morphSteps - 1);
+                float* r = data.data() + (shape * morphSteps + m) * rowSize;
+
+                for (int i = 0; i <= phaseSteps; ++i)
+                {
+                    const float phase = i / float(phaseSteps);
+                    const float a = evaluateShape(shape, phase);
+                    const float b = evaluateShape(next, phase);
+                    r[i] = a + morph * (b - a);
+                }
+                r[phaseSteps + 1] = r[phaseSteps];
+                peaks[size_t(shape * morphSteps + m)] = float(std::max_element(r, r + phaseSteps + 1) - r);
+            }
+        }
+    }
+
+    const float* row(int shape, int morphIndex) const noexcept
+    {
+        return data.data() + (shape * morphSteps + morphIndex) * rowSize;
+    }
+};
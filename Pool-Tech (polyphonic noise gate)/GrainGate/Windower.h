@@ -1,5 +1,6 @@
 #pragma once
 #include <juce_core/juce_core.h>
+#include "WindowMorphTable.h"
 #include <cmath>
 
 struct WindowerParams
@@ -21,10 +22,13 @@ struct WindowerParams
     float randomness = 0.0f;
     bool useBeats = false;
     bool stereoCorrelation = false;
-    float crossfade = 1.0f;
+    float crossfade = 0.0f; // Morph from windowType towards the next shape (0..1)
+    float coalesceMs = 0.0f; // Triggers this close to a live grain restart it instead of taking a new voice
     bool lockToGrid = false;
 };
 
+// SampleType is the audio sample type (float or double); envelopes are always computed in float.
+template <typename SampleType>
 class Windower
 {
 public:
@@ -33,6 +37,7 @@ public:
     void prepare(double newSampleRate)
     {
         sampleRate = newSampleRate;
+        morphTable = &WindowMorphTable::get(); // builds the shared table off the audio thread
         reset();
     }
 
@@ -54,6 +59,7 @@ public:
         windowType  = windowTypeToUse;
         envParams   = params;
         active      = true;
+        lastGain    = prevGain = 0.0f;
 
         if (windowTypeToUse >= 10)
         {
@@ -61,11 +67,77 @@ public:
             envSample = 0;
             envState  = EnvState::Attack;
         }
+        else
+        {
+            jassert(morphTable != nullptr); // prepare() must run before the first grain
+            cursor      = morphTable->getCursor(windowTypeToUse, params.crossfade);
+            phaseScale  = float(WindowMorphTable::phaseSteps) / float(std::max(1, windowLengthSamples - 1));
+            phaseOffset = 0.0f;
+        }
+    }
+
+    // Restarts the envelope at the first sample of its rising edge whose gain is at least
+    // the gain just output, so a retrigger continues without a step (trigger coalescing).
+    // Shapes that peak late (Exponential and morphs towards it) would land so close to
+    // their end that the retrigger is lost; when less than half the new grain would be
+    // left, the rest of the shape from the landing point is stretched over the full length.
+    void restartFromCurrentGain(int windowTypeToUse, int windowLengthSamples, const WindowerParams& params = {})
+    {
+        const float gain = active ? lastGain : 0.0f;
+        startNewGrain(0, windowTypeToUse, windowLengthSamples, params);
+
+        if (gain <= 0.0f)
+            return;
+
+        if (windowTypeToUse >= 10)
+        {
+            envSample = int(std::ceil(gain * float(attackSamples)));
+            if (envSample >= attackSamples)
+            {
+                envSample = 0;
+                envState  = EnvState::Decay; // Decay starts at the peak
+            }
+        }
+        else
+        {
+            int peak = 0;
+            const int point = cursor.findFirstPointReaching(gain, cheapReads, peak);
+            sampleIndex = firstSampleReaching(gain, float(point), float(peak));
+
+            if (length - sampleIndex < length / 2)
+            {
+                sampleIndex = 0;
+                phaseOffset = float(point); // Sample 0 reads exactly that point
+                phaseScale  = (float(WindowMorphTable::phaseSteps) - phaseOffset) / float(std::max(1, length - 1));
+            }
+        }
+        lastGain = prevGain = gain;
     }
 
     bool isActive() const { return active; }
 
-    float process(float input)
+    // Trades interpolation for speed on window shapes (set by the quality governor)
+    void setCheapReads(bool shouldUseCheapReads) { cheapReads = shouldUseCheapReads; }
+
+    // True once the envelope is past its peak and has dropped below level (safe to cull)
+    bool isFadingBelow(float level) const
+    {
+        if (lastGain >= level || lastGain >= prevGain)
+            return false;
+
+        // Shapes that start from (float) zero, like Blackman, dip slightly on their first samples
+        if (windowType >= 10)
+            return envState != EnvState::Attack;
+        return phaseOffset + float(sampleIndex - 1) * phaseScale > cursor.peakPos;
+    }
+
+    SampleType process(SampleType input)
+    {
+        return input * SampleType(nextGain());
+    }
+
+    // Envelope gain for the next sample (0 once the grain has ended); advances the grain
+    float nextGain()
     {
         if (!active)
             return 0.0f;
@@ -75,7 +147,10 @@ public:
         if (windowType >= 10)
             gain = processADSR();
         else
-            gain = evaluateWindow(sampleIndex, length, windowType);
+            gain = evaluateWindow(sampleIndex);
+
+        prevGain = lastGain;
+        lastGain = gain;
 
         ++sampleIndex;
         if (sampleIndex >= length || (windowType >= 10 && envState == EnvState::Idle))
@@ -83,7 +158,35 @@ public:
             active = false;
             return 0.0f;
         }
-        return input * gain;
+        return gain;
+    }
+
+    // Calls of nextGain() until the grain ends, the ending call included
+    int getSamplesUntilEnd() const
+    {
+        if (!active)
+            return 0;
+
+        int remaining = length - sampleIndex;
+        if (windowType >= 10)
+            remaining = std::min(remaining, envelopeSamplesUntilIdle());
+        return std::max(1, remaining);
+    }
+
+    // Same end state as n calls of nextGain(), but only the last two samples are evaluated
+    // (they set lastGain/prevGain, which coalescing and culling read)
+    void advance(int n)
+    {
+        if (!active)
+            return;
+
+        const int skip = std::max(0, std::min(n, getSamplesUntilEnd()) - 2);
+        sampleIndex += skip;
+        if (windowType >= 10)
+            skipEnvelope(skip);
+
+        for (int i = skip; i < n && active; ++i)
+            nextGain();
     }
 
     // For GUI/debugging
@@ -108,6 +211,15 @@ private:
     int windowType = 0;
     bool active = false;
 
+    // Window shapes (windowType < 10) are read from the shared morph table
+    const WindowMorphTable* morphTable = nullptr;
+    WindowMorphTable::Cursor cursor;
+    float phaseScale = 1.0f;  // table positions per sample
+    float phaseOffset = 0.0f; // table position of sample 0 (non-zero only for stretched retriggers)
+    bool cheapReads = false;
+
+    float lastGain = 0.0f, prevGain = 0.0f;
+
     // ADSR structures
     enum class EnvState { Idle, Attack, Decay, Sustain, Release };
     EnvState envState = EnvState::Idle;
@@ -129,6 +241,52 @@ private:
         sustainSamples = std::max(totalLength - used, 1);
     }
 
+    int envelopeSamplesUntilIdle() const
+    {
+        const int attackLeft  = std::max(1, attackSamples  - envSample);
+        const int decayLeft   = std::max(1, decaySamples   - envSample);
+        const int sustainLeft = std::max(1, sustainSamples - envSample);
+        const int releaseLeft = std::max(1, releaseSamples - envSample);
+
+        switch (envState)
+        {
+            case EnvState::Attack:  return attackLeft + decaySamples + sustainSamples + releaseSamples;
+            case EnvState::Decay:   return decayLeft + sustainSamples + releaseSamples;
+            case EnvState::Sustain: return sustainLeft + releaseSamples;
+            case EnvState::Release: return releaseLeft;
+            default:                return 1;
+        }
+    }
+
+    // Moves the ADSR position on by n samples (n must end before Idle), as processADSR() would
+    void skipEnvelope(int n)
+    {
+        while (n > 0)
+        {
+            int stageLength = 1;
+            EnvState next = EnvState::Idle;
+            switch (envState)
+            {
+                case EnvState::Attack:  stageLength = attackSamples;  next = EnvState::Decay;   break;
+                case EnvState::Decay:   stageLength = decaySamples;   next = EnvState::Sustain; break;
+                case EnvState::Sustain: stageLength = sustainSamples; next = EnvState::Release; break;
+                case EnvState::Release: stageLength = releaseSamples; next = EnvState::Idle;    break;
+                default: jassertfalse; return;
+            }
+
+            const int left = std::max(1, stageLength - envSample);
+            if (n < left)
+            {
+                envSample += n;
+                return;
+            }
+
+            n -= left;
+            envSample = 0;
+            envState  = next;
+        }
+    }
+
     float processADSR()
     {
         float value = 0.0f;
@@ -170,27 +328,25 @@ private:
         return value;
     }
 
-    // Window-based envelopes
-    float evaluateWindow(int sampleIdx, int length, int type) const
+    // Window-based envelopes: one bilinear table read, morph rows resolved in startNewGrain
+    float evaluateWindow(int sampleIdx) const
     {
         jassert(sampleIdx >= 0 && sampleIdx < length);
-        float phase = sampleIdx / float(length - 1);
+        const float pos = phaseOffset + float(sampleIdx) * phaseScale;
+        return cheapReads ? cursor.readNearest(pos) : cursor.read(pos);
+    }
 
-        switch (type)
-        {
-            case 0: // Hann
-                return 0.5f * (1.0f - std::cos(juce::MathConstants<float>::twoPi * phase));
-            case 1: // Triangle
-                return 1.0f - std::abs(2.0f * phase - 1.0f);
-            case 2: // Blackman
-                return 0.42f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * phase)
-                             + 0.08f * std::cos(2.0f * juce::MathConstants<float>::twoPi * phase);
-            case 3: // Rectangular
-                return 1.0f;
-            case 4: // Exponential
-                return phase <= 1.0f ? std::exp(-4.0f * (1.0f - phase)) : 0.0f;
-            default:
-                return 1.0f;
-        }
+    // First sample on the rising edge whose gain reaches gain, starting from table position pos
+    int firstSampleReaching(float gain, float pos, float peakPos) const
+    {
+        // One table step of slack: cheap reads round to the nearest table point
+        const int peakIndex = juce::jlimit(0, length - 1, int(std::ceil((peakPos + 1.0f) / phaseScale)));
+        int idx = juce::jlimit(0, peakIndex, int(std::ceil(pos / phaseScale)));
+
+        while (idx > 0 && evaluateWindow(idx - 1) >= gain)
+            --idx;
+        while (idx < peakIndex && evaluateWindow(idx) < gain)
+            ++idx;
+        return idx;
     }
 };
@@ -1,31 +1,79 @@
-constexpr int fftOrder = 9; // 512-point FFT
-constexpr int fftSize = 1 << fftOrder;
-constexpr int scopeSize = 128; // Number of bands in your display
-
-juce::dsp::FFT fft { fftOrder };
-juce::dsp::WindowingFunction<float> window { fftSize, juce::dsp::WindowingFunction<float>::hann };
-float fifo[fftSize];
-float fftData[2 * fftSize];
-float scopeData[scopeSize];
-
-void pushNextSampleIntoFifo(float sample) {
-    // Fill FIFO, run FFT when full
-    fifo[fifoIndex++] = sample;
-    if (fifoIndex == fftSize) {
-        std::copy(fifo, fifo+fftSize, fftData);
-        window.multiplyWithWindowingTable(fftData, fftSize);
-        fft.performFrequencyOnlyForwardTransform(fftData);
-
-        // Fill scopeData
-        for (int i = 0; i < scopeSize; ++i) {
-            // Simple mapping: log/linear, or averaging bins
-            int bin = i * (fftSize/2) / scopeSize;
-            float mag = juce::Decibels::gainToDecibels(fftData[bin]);
-            // normalize to 0...1 for drawing (map appropriate range)
-            scopeData[i] = juce::jmap(mag, -100.0f, 0.0f, 0.0f, 1.0f);
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <algorithm>
+#include <atomic>
+
+//==============================================================================
+// Sidechain spectrum for the band selector. Plain arrays only, so one lives in
+// each instance's DSP arena; the FFT engine and window table are shared.
+// Scope frames go from the audio thread to the GUI through a triple buffer: each
+// side owns one frame and swaps it with the shared latest one, so neither ever
+// reads a frame the other is writing.
+struct SpectrumAnalyzer
+{
+    static constexpr int fftOrder = 9; // 512-point FFT
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int scopeSize = 128; // Number of bands in your display
+
+    float fifo[fftSize] {};
+    float fftData[2 * fftSize] {};
+    float scopeFrames[3][scopeSize] {};
+    int fifoIndex = 0;
+    int writeFrame = 0;                      // Audio thread only
+    int readFrame = 1;                       // GUI only
+    std::atomic<int> latestFrame { 2 };      // Frame index, | freshFrame when not yet pulled
+
+    // Builds the shared tables (allocates on first use, so not from the audio thread)
+    static void prepareShared()
+    {
+        getFft();
+        getWindow();
+    }
+
+    void pushNextSampleIntoFifo(float sample) {
+        // Fill FIFO, run FFT when full
+        fifo[fifoIndex++] = sample;
+        if (fifoIndex == fftSize) {
+            std::copy(fifo, fifo+fftSize, fftData);
+            getWindow().multiplyWithWindowingTable(fftData, fftSize);
+            getFft().performFrequencyOnlyForwardTransform(fftData);
+
+            // Fill this side's scope frame, then publish it
+            float* scopeData = scopeFrames[writeFrame];
+            for (int i = 0; i < scopeSize; ++i) {
+                // Simple mapping: log/linear, or averaging bins
+                int bin = i * (fftSize/2) / scopeSize;
+                float mag = juce::Decibels::gainToDecibels(fftData[bin]);
+                // normalize to 0...1 for drawing (map appropriate range)
+                scopeData[i] = juce::jmap(mag, -100.0f, 0.0f, 0.0f, 1.0f);
+            }
+
+            fifoIndex = 0;
+            writeFrame = latestFrame.exchange(writeFrame | freshFrame, std::memory_order_acq_rel) & frameMask;
         }
+    }
+
+    // GUI side: copies a new frame into dest (scopeSize values) if one is ready
+    bool pullScopeData(float* dest) {
+        if ((latestFrame.load(std::memory_order_relaxed) & freshFrame) == 0)
+            return false;
+        readFrame = latestFrame.exchange(readFrame, std::memory_order_acq_rel) & frameMask;
+        std::copy(scopeFrames[readFrame], scopeFrames[readFrame] + scopeSize, dest);
+        return true;
+    }
+
+private:
+    static constexpr int frameMask = 3, freshFrame = 4;
+
+    static const juce::dsp::FFT& getFft()
+    {
+        static const juce::dsp::FFT fft { fftOrder };
+        return fft;
+    }
 
-        fifoIndex = 0;
-        nextFFTBlockReady = true;
+    static const juce::dsp::WindowingFunction<float>& getWindow()
+    {
+        static const juce::dsp::WindowingFunction<float> window { fftSize, juce::dsp::WindowingFunction<float>::hann };
+        return window;
     }
-}
+};
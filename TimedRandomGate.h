@@ -7,9 +7,10 @@
   Description:
     A time-gated random modulator for controlled probabilistic signal events.
     At each new evaluation (e.g., grain trigger), this class determines whether
-    to allow randomization based on a looping one-hot vector whose loop length
-    shortens with increased randomness, thus increasing the chances of allowing
-    random behavior. When active, it applies a shaped randomness function for
+    to allow randomization based on a position counter that wraps at a loop
+    length; only the first position of each loop allows it. The loop shortens
+    with increased randomness, thus increasing the chances of allowing random
+    behavior. When active, it applies a shaped randomness function for
     flipping gate/sequence values.
 
     Useful for granular synthesis, probabilistic sequencing, jitter modulation,
@@ -49,7 +50,6 @@
 
 #pragma once
 
-#include <vector>
 #include <random>
 #include <algorithm>
 #include <cmath>
@@ -67,8 +67,6 @@ public:
     void setSampleRate(int sr)
     {
         sampleRate = sr;
-        modBuffer.resize(sr);
-        fillOneHotBuffer();
     }
 
     void seed(unsigned int s)
@@ -90,7 +88,7 @@ public:
     // Call once per sample, returns true only when real randomization is allowed
     bool shouldRandomizeThisSample()
     {
-        bool trigger = (modBuffer[modPosition] == 1);
+        bool trigger = (modPosition == 0); // Only the first position of each loop
         modPosition = (modPosition + 1) % loopLength;
 
         return trigger;
@@ -110,7 +108,6 @@ public:
     }
 
 private:
-    std::vector<int> modBuffer;
     int modPosition = 0;
     int sampleRate  = 44100;
     int loopLength  = 44100; // Starts at 1s window
@@ -120,12 +117,6 @@ private:
     std::mt19937 rng { std::random_device{}() };
     static inline std::atomic<unsigned> defaultSeed { 12345 };
 
-    void fillOneHotBuffer()
-    {
-        std::fill(modBuffer.begin(), modBuffer.end(), 0);
-        modBuffer[0] = 1;
-    }
-
     void updateLoopSize()
     {
         loopLength = std::max(1, static_cast<int>(sampleRate * (1.0f - randomnessStrength)));